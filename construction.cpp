@@ -0,0 +1,183 @@
+//
+//  construction.cpp
+//  TSP
+//
+//  Tours built from scratch: along a space-filling curve, and from a
+//  spanning tree and a matching in the way of Christofides.
+//
+
+#include "construction.h"
+#include <algorithm>
+#include <queue>
+#include <functional>
+#include <math.h>
+
+// Position of the cell (x, y) along the Hilbert curve through a grid of
+// 2^order by 2^order cells
+static unsigned long long hilbertIndex(unsigned long long x, unsigned long long y, int order) {
+    unsigned long long side = 1ULL << order;
+    unsigned long long re   = 0;
+    for (unsigned long long s = side / 2; s > 0; s /= 2) {
+        unsigned long long rx = (x & s) > 0;
+        unsigned long long ry = (y & s) > 0;
+        re += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }//if
+            swap(x, y);
+        }//if
+    }//for
+    return re;
+}
+
+// Builds the graph's sorted adjacency if it has none yet
+TourConstructor::TourConstructor(Graph& graph) {
+    _graph     = &graph;
+    _edges     = graph.edges();
+    _adjacency = &graph.sortedAdjacency();
+    _ncount    = graph.nodesCount();
+}
+
+// The nodes in the order the Hilbert curve through their bounding box
+// visits them; neighbors on the curve are close in the plane. Only geo
+// graphs have coordinates to order.
+void TourConstructor::spaceFillingCurve(vector<Identifier>& tour) const {
+    const vector<Node>& nodes = _graph->nodes();
+    double minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+    for (const Node& v : nodes) {
+        minX = min(minX, v.x); maxX = max(maxX, v.x);
+        minY = min(minY, v.y); maxY = max(maxY, v.y);
+    }//for
+    double scale = ((1ULL << HILBERT_ORDER) - 1) / max(max(maxX - minX, maxY - minY), 1e-9);
+
+    vector<pair<unsigned long long, Identifier> > keys(_ncount);
+    for (size_t i = 0; i < _ncount; i++) {
+        unsigned long long x = (unsigned long long) ((nodes[i].x - minX) * scale);
+        unsigned long long y = (unsigned long long) ((nodes[i].y - minY) * scale);
+        keys[i] = make_pair(hilbertIndex(x, y, HILBERT_ORDER), (Identifier) i);
+    }//for
+    std::sort(keys.begin(), keys.end());
+
+    tour.resize(_ncount);
+    for (size_t i = 0; i < _ncount; i++)
+        tour[i] = keys[i].second;
+}
+
+// Minimum spanning tree by Prim, one tree per component of the graph;
+// tree[v] lists the tree neighbors of v
+void TourConstructor::_spanningForest(vector<vector<Identifier> >& tree) const {
+    typedef pair<double, pair<Identifier, Identifier> > Candidate;
+    priority_queue<Candidate, vector<Candidate>, greater<Candidate> > heap;
+    vector<char> inTree(_ncount, false);
+    tree.assign(_ncount, vector<Identifier>());
+
+    for (Identifier root = 0; root < (Identifier) _ncount; root++) {
+        if (inTree[root]) continue;
+        heap.push(make_pair(0.0, make_pair(root, INVALID_ID)));
+        while (!heap.empty()) {
+            Identifier v      = heap.top().second.first;
+            Identifier parent = heap.top().second.second;
+            heap.pop();
+            if (inTree[v]) continue;
+
+            inTree[v] = true;
+            if (parent != INVALID_ID) {
+                tree[v].push_back(parent);
+                tree[parent].push_back(v);
+            }//if
+            ArrayView<Identifier> near = _adjacency->neighbors(v);
+            ArrayView<Identifier> ids  = _adjacency->edgeIds(v);
+            for (size_t k = 0; k < near.size(); k++)
+                if (!inTree[near[k]])
+                    heap.push(make_pair(_edges[ids[k]].weight(), make_pair(near[k], v)));
+        }//while
+    }//for
+}
+
+// Greedy matching of the odd degree nodes of the tree, shortest edges
+// first; nodes left without a partner are paired in identifier order
+void TourConstructor::_oddMatching(const vector<vector<Identifier> >& tree, vector<pair<Identifier, Identifier> >& matching) const {
+    vector<char> odd(_ncount, false);
+    for (size_t v = 0; v < _ncount; v++)
+        odd[v] = tree[v].size() % 2 == 1;
+
+    vector<pair<double, size_t> > candidates;
+    for (size_t i = 0; i < _edges.size(); i++)
+        if (odd[_edges[i].source()] && odd[_edges[i].destination()])
+            candidates.push_back(make_pair(_edges[i].weight(), i));
+    std::sort(candidates.begin(), candidates.end());
+
+    matching.clear();
+    for (const pair<double, size_t>& c : candidates) {
+        Identifier u = _edges[c.second].source();
+        Identifier v = _edges[c.second].destination();
+        if (!odd[u] || !odd[v] || u == v) continue;
+        matching.push_back(make_pair(u, v));
+        odd[u] = odd[v] = false;
+    }//for
+
+    Identifier unmatched = INVALID_ID;
+    for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+        if (!odd[v]) continue;
+        if (unmatched == INVALID_ID)
+            unmatched = v;
+        else {
+            matching.push_back(make_pair(unmatched, v));
+            unmatched = INVALID_ID;
+        }//else
+    }//for
+}
+
+// Spanning tree plus a matching of its odd nodes, walked as an Euler
+// tour that skips the nodes seen before. The matching is greedy rather
+// than of minimum weight, so the 3/2 guarantee does not hold.
+void TourConstructor::christofides(vector<Identifier>& tour) const {
+    vector<vector<Identifier> >          tree;
+    vector<pair<Identifier, Identifier> > matching;
+    _spanningForest(tree);
+    _oddMatching(tree, matching);
+
+    // Multigraph of the tree and matching links; each link is stored at
+    // both ends with its index
+    vector<vector<pair<Identifier, size_t> > > links(_ncount);
+    size_t count = 0;
+    for (Identifier v = 0; v < (Identifier) _ncount; v++)
+        for (Identifier u : tree[v])
+            if (v < u) {
+                links[v].push_back(make_pair(u, count));
+                links[u].push_back(make_pair(v, count++));
+            }//if
+    for (const pair<Identifier, Identifier>& m : matching) {
+        links[m.first].push_back(make_pair(m.second, count));
+        links[m.second].push_back(make_pair(m.first, count++));
+    }//for
+
+    // Hierholzer's algorithm, one circuit per component
+    vector<char>       used(count, false);
+    vector<size_t>     cursor(_ncount, 0);
+    vector<char>       seen(_ncount, false);
+    vector<Identifier> stack;
+    tour.clear();
+    for (Identifier root = 0; root < (Identifier) _ncount; root++) {
+        if (seen[root]) continue;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            Identifier v = stack.back();
+            while (cursor[v] < links[v].size() && used[links[v][cursor[v]].second])
+                cursor[v]++;
+            if (cursor[v] < links[v].size()) {
+                used[links[v][cursor[v]].second] = true;
+                stack.push_back(links[v][cursor[v]].first);
+            }//if
+            else {
+                stack.pop_back();
+                if (!seen[v]) {
+                    seen[v] = true;
+                    tour.push_back(v);
+                }//if
+            }//else
+        }//while
+    }//for
+}
@@ -0,0 +1,41 @@
+//
+//  construction.h
+//  TSP
+//
+//  Tours built from scratch: along a space-filling curve, and from a
+//  spanning tree and a matching in the way of Christofides.
+//
+
+#ifndef __TSP__construction__
+#define __TSP__construction__
+
+#include <vector>
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define HILBERT_ORDER  16
+
+// Constructive heuristics that complement the nearest neighbor tour and
+// the greedy edge tour. Both may put pairs of nodes without an edge next
+// to each other on a sparse graph; TourImprover takes those out. The
+// constructor is read-only once built, so threads can share it.
+class TourConstructor {
+private:
+    Graph*           _graph;
+    ArrayView<Edge>  _edges;
+    const Adjacency* _adjacency;
+    size_t           _ncount;
+
+    void _spanningForest(vector<vector<Identifier> >&) const;
+    void _oddMatching   (const vector<vector<Identifier> >&, vector<pair<Identifier, Identifier> >&) const;
+
+public:
+    TourConstructor(Graph&);
+
+    void spaceFillingCurve(vector<Identifier>&) const;
+    void christofides     (vector<Identifier>&) const;
+};
+
+#endif /* defined(__TSP__construction__) */
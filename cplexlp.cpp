@@ -0,0 +1,212 @@
+//
+//  cplexlp.cpp
+//  TSP
+//
+//  LP backend on top of CPLEX Concert, built with -DTSP_USE_CPLEX.
+//
+
+#include "cplexlp.h"
+
+#ifdef TSP_USE_CPLEX
+
+#include <sstream>
+
+static char toLPStatus(IloCplex::BasisStatus status) {
+    switch (status) {
+        case IloCplex::Basic:
+            return LP_BASIC;
+        case IloCplex::AtUpper:
+            return LP_AT_UPPER;
+        default:
+            return LP_AT_LOWER;
+    }//switch
+}
+
+static IloCplex::BasisStatus toCplexStatus(char status) {
+    switch (status) {
+        case LP_BASIC:
+            return IloCplex::Basic;
+        case LP_AT_UPPER:
+            return IloCplex::AtUpper;
+        default:
+            return IloCplex::AtLower;
+    }//switch
+}
+
+CplexLPSolver::CplexLPSolver() : _env(), _model(_env), _objective(IloMinimize(_env)), _X(_env), _rows(_env), _cplex(_env) {
+    _model.add(_objective);
+    
+    // One extraction for the whole lifetime: later changes to the model
+    // are passed on incrementally and each solve reoptimizes with dual
+    // simplex from the basis of the previous one
+    _cplex.extract(_model);
+    _cplex.setOut(_env.getNullStream());
+    _cplex.setParam(IloCplex::RootAlg, IloCplex::Dual);
+    _objValue       = 0;
+    _iterations     = 0;
+    _iterationLimit = 0;
+}
+
+CplexLPSolver::~CplexLPSolver() {
+    _env.end();
+}
+
+size_t CplexLPSolver::addColumn(double cost, double lb, double ub) {
+    stringstream ss;
+    ss << "x" << _X.getSize();
+    IloNumVar x(_env, lb, ub, ILOFLOAT, ss.str().c_str());
+    _X.add(x);
+    _objective.setLinearCoef(x, cost);
+    return _X.getSize() - 1;
+}
+
+size_t CplexLPSolver::addRow(const vector<size_t>& cols, const vector<double>& coefs, double lb, double ub) {
+    IloExpr expr(_env);
+    for (size_t k = 0; k < cols.size(); k++)
+        expr += coefs[k] * _X[cols[k]];
+    
+    IloRange row(_env, lb <= -LP_INFINITY ? -IloInfinity : lb, expr, ub >= LP_INFINITY ? IloInfinity : ub);
+    expr.end();
+    _model.add(row);
+    _rows.add(row);
+    return _rows.getSize() - 1;
+}
+
+void CplexLPSolver::removeRows(const vector<size_t>& rows) {
+    // From the back, so that the positions still to remove stay valid
+    for (size_t k = rows.size(); k > 0; k--) {
+        IloRange row = _rows[rows[k - 1]];
+        _model.remove(row);
+        _rows.remove(rows[k - 1]);
+        row.end();
+    }//for
+}
+
+void CplexLPSolver::setBounds(size_t j, double lb, double ub) {
+    _X[j].setBounds(lb, ub);
+}
+
+void CplexLPSolver::setRowBounds(size_t i, double lb, double ub) {
+    _rows[i].setBounds(lb <= -LP_INFINITY ? -IloInfinity : lb, ub >= LP_INFINITY ? IloInfinity : ub);
+}
+
+double CplexLPSolver::lowerBound(size_t j) {
+    return _X[j].getLB();
+}
+
+double CplexLPSolver::upperBound(size_t j) {
+    return _X[j].getUB();
+}
+
+size_t CplexLPSolver::columnsCount() {
+    return _X.getSize();
+}
+
+size_t CplexLPSolver::rowsCount() {
+    return _rows.getSize();
+}
+
+LPStatus CplexLPSolver::solve() {
+    if (_startBasis.columns.size() == (size_t) _X.getSize() && _startBasis.rows.size() <= (size_t) _rows.getSize()) {
+        IloCplex::BasisStatusArray cstat(_env), rstat(_env);
+        for (size_t j = 0; j < _startBasis.columns.size(); j++)
+            cstat.add(toCplexStatus(_startBasis.columns[j]));
+        for (IloInt i = 0; i < _rows.getSize(); i++)
+            rstat.add((size_t) i < _startBasis.rows.size() ? toCplexStatus(_startBasis.rows[i]) : IloCplex::Basic);
+        _cplex.setBasisStatuses(cstat, _X, rstat, _rows);
+    }//if
+    _startBasis = LPBasis();
+    
+    _cplex.solve();
+    _iterations = _cplex.getNiterations();
+    
+    LPStatus re;
+    if (_cplex.getCplexStatus() == IloCplex::AbortItLim) {
+        // Dual simplex stops at a dual feasible basis
+        _objValue = _cplex.getObjValue();
+        return LP_ITERATION_LIMIT;
+    }//if
+    switch (_cplex.getStatus()) {
+        case IloAlgorithm::Optimal:
+            re = LP_OPTIMAL;
+            break;
+        case IloAlgorithm::Infeasible:
+            re = LP_INFEASIBLE;
+            break;
+        case IloAlgorithm::Unbounded:
+            re = LP_UNBOUNDED;
+            break;
+        default:
+            re = LP_ABORTED;
+            break;
+    }//switch
+    
+    if (re == LP_OPTIMAL) {
+        IloNumArray vals(_env), duals(_env), reduced(_env);
+        _cplex.getValues(vals, _X);
+        _cplex.getDuals(duals, _rows);
+        _cplex.getReducedCosts(reduced, _X);
+        _objValue = _cplex.getObjValue();
+        
+        _vals.resize(vals.getSize());
+        for (IloInt j = 0; j < vals.getSize(); j++)
+            _vals[j] = vals[j];
+        _duals.resize(duals.getSize());
+        for (IloInt i = 0; i < duals.getSize(); i++)
+            _duals[i] = duals[i];
+        _reduced.resize(reduced.getSize());
+        for (IloInt j = 0; j < reduced.getSize(); j++)
+            _reduced[j] = reduced[j];
+        
+        IloCplex::BasisStatusArray cstat(_env), rstat(_env);
+        _cplex.getBasisStatuses(cstat, _X, rstat, _rows);
+        _basis.columns.resize(cstat.getSize());
+        for (IloInt j = 0; j < cstat.getSize(); j++)
+            _basis.columns[j] = toLPStatus(cstat[j]);
+        _basis.rows.resize(rstat.getSize());
+        for (IloInt i = 0; i < rstat.getSize(); i++)
+            _basis.rows[i] = toLPStatus(rstat[i]);
+        
+        vals.end();
+        duals.end();
+        reduced.end();
+    }//if
+    
+    return re;
+}
+
+double CplexLPSolver::objValue() {
+    return _objValue;
+}
+
+void CplexLPSolver::primalValues(vector<double>& vals) {
+    vals = _vals;
+}
+
+void CplexLPSolver::dualValues(vector<double>& duals) {
+    duals = _duals;
+}
+
+void CplexLPSolver::reducedCosts(vector<double>& costs) {
+    costs = _reduced;
+}
+
+void CplexLPSolver::getBasis(LPBasis& basis) {
+    basis = _basis;
+}
+
+void CplexLPSolver::setBasis(const LPBasis& basis) {
+    _startBasis = basis;
+}
+
+long CplexLPSolver::iterations() {
+    return _iterations;
+}
+
+// Zero for no limit
+void CplexLPSolver::setIterationLimit(long limit) {
+    _iterationLimit = limit;
+    _cplex.setParam(IloCplex::ItLim, limit > 0 ? limit : IloIntMax);
+}
+
+#endif /* TSP_USE_CPLEX */
@@ -0,0 +1,64 @@
+//
+//  cplexlp.h
+//  TSP
+//
+//  LP backend on top of CPLEX Concert, built with -DTSP_USE_CPLEX.
+//
+
+#ifndef __TSP__cplexlp__
+#define __TSP__cplexlp__
+
+#ifdef TSP_USE_CPLEX
+
+#include <vector>
+#include <ilcplex/ilocplex.h>
+#include "lp.h"
+using namespace std;
+
+class CplexLPSolver : public LPSolver {
+private:
+    IloEnv               _env;
+    IloModel             _model;
+    IloObjective         _objective;
+    IloNumVarArray       _X;
+    IloRangeArray        _rows;
+    IloCplex             _cplex;
+    
+    // Results of the last solve
+    double               _objValue;
+    vector<double>       _vals;
+    vector<double>       _duals;
+    vector<double>       _reduced;
+    LPBasis              _basis;
+    LPBasis              _startBasis;
+    long                 _iterations;
+    long                 _iterationLimit;
+    
+public:
+    CplexLPSolver ();
+    ~CplexLPSolver();
+    
+    size_t   addColumn   (double, double, double);
+    size_t   addRow      (const vector<size_t>&, const vector<double>&, double, double);
+    void     removeRows  (const vector<size_t>&);
+    void     setBounds   (size_t, double, double);
+    void     setRowBounds(size_t, double, double);
+    double   lowerBound  (size_t);
+    double   upperBound  (size_t);
+    size_t   columnsCount();
+    size_t   rowsCount   ();
+    
+    LPStatus solve       ();
+    double   objValue    ();
+    void     primalValues(vector<double>&);
+    void     dualValues  (vector<double>&);
+    void     reducedCosts(vector<double>&);
+    void     getBasis    (LPBasis&);
+    void     setBasis    (const LPBasis&);
+    long     iterations  ();
+    void     setIterationLimit(long);
+};
+
+#endif /* TSP_USE_CPLEX */
+
+#endif /* defined(__TSP__cplexlp__) */
@@ -0,0 +1,243 @@
+//
+//  cutpool.cpp
+//  TSP
+//
+//  Pool of the cuts found during the search and the LP rows they occupy.
+//
+
+#include "cutpool.h"
+#include <algorithm>
+#include <utility>
+#include <math.h>
+
+#define NO_CUT ((size_t) -1)
+
+CutPool::CutPool(Graph& graph, size_t baseRows) : Separator(graph) {
+    _baseRows  = baseRows;
+    _liveCount = 0;
+    _round     = 0;
+    _purged    = 0;
+}
+
+size_t CutPool::_hash(const Cut& cut) const {
+    size_t re = cut.teeth.size();
+    for (size_t k = 0; k <= cut.teeth.size(); k++) {
+        const vector<Identifier>& nodes = (k == 0) ? cut.nodes : cut.teeth[k - 1];
+        for (Identifier v : nodes)
+            re = re * 1000003 + (size_t) v;
+        re = re * 31 + nodes.size();
+    }//for
+    return re;
+}
+
+size_t CutPool::_find(const Cut& cut) const {
+    pair<multimap<size_t, size_t>::const_iterator, multimap<size_t, size_t>::const_iterator> range = _hashes.equal_range(_hash(cut));
+    for (multimap<size_t, size_t>::const_iterator it = range.first; it != range.second; it++) {
+        const Cut& other = _cuts[it->second].cut;
+        if (other.nodes == cut.nodes && other.teeth == cut.teeth)
+            return it->second;
+    }//for
+    return NO_CUT;
+}
+
+void CutPool::_activate(size_t id, LPSolver& lp) {
+    vector<size_t> ids;
+    vector<double> coefs;
+    cutRow(_cuts[id].cut, ids, coefs);
+    lp.addRow(ids, coefs, _cuts[id].cut.rhs(), LP_INFINITY);
+    
+    _cuts[id].active  = true;
+    _cuts[id].age     = 0;
+    _cuts[id].touched = _round;
+    _active.push_back(id);
+}
+
+void CutPool::_drop(size_t id) {
+    pair<multimap<size_t, size_t>::iterator, multimap<size_t, size_t>::iterator> range = _hashes.equal_range(_hash(_cuts[id].cut));
+    for (multimap<size_t, size_t>::iterator it = range.first; it != range.second; it++) {
+        if (it->second == id) {
+            _hashes.erase(it);
+            break;
+        }//if
+    }//for
+    
+    // Ids stay valid for the bases that still refer to them
+    _cuts[id].cut  = Cut();
+    _cuts[id].live = false;
+    _liveCount--;
+}
+
+// Adds a cut to the pool and its row to the LP; false if it is already
+// in the LP
+bool CutPool::add(const Cut& cut, LPSolver& lp) {
+    size_t id = _find(cut);
+    if (id == NO_CUT) {
+        PoolCut entry;
+        entry.cut     = cut;
+        entry.live    = true;
+        entry.active  = false;
+        entry.pinned  = false;
+        entry.age     = 0;
+        entry.touched = _round;
+        id = _cuts.size();
+        _cuts.push_back(entry);
+        _hashes.insert(make_pair(_hash(cut), id));
+        _liveCount++;
+    }//if
+    else if (_cuts[id].active)
+        return false;
+    
+    _activate(id, lp);
+    return true;
+}
+
+// Puts the pool cuts violated by a solution back into the LP, the most
+// violated first and at most maxCuts of them; returns how many
+size_t CutPool::separate(const vector<double>& vals, size_t maxCuts, LPSolver& lp) {
+    _buildSupport(vals);
+    
+    vector<pair<double, size_t> > violated;
+    for (size_t id = 0; id < _cuts.size(); id++) {
+        if (!_cuts[id].live || _cuts[id].active) continue;
+        double violation = _cuts[id].cut.rhs() - _supportValue(_cuts[id].cut);
+        if (violation > CUT_EPSILON)
+            violated.push_back(make_pair(-violation, id));
+    }//for
+    
+    sort(violated.begin(), violated.end());
+    if (violated.size() > maxCuts)
+        violated.resize(maxCuts);
+    for (size_t k = 0; k < violated.size(); k++)
+        _activate(violated[k].second, lp);
+    return violated.size();
+}
+
+// Counts one more solve for every active cut that the solution leaves
+// slack, and restarts the count of the binding ones
+void CutPool::age(const vector<double>& vals) {
+    _round++;
+    _buildSupport(vals);
+    
+    for (size_t id : _active) {
+        PoolCut& entry = _cuts[id];
+        if (entry.pinned)
+            continue;
+        if (_supportValue(entry.cut) > entry.cut.rhs() + CUT_EPSILON)
+            entry.age++;
+        else {
+            entry.age     = 0;
+            entry.touched = _round;
+        }//else
+    }//for
+}
+
+// Removes the rows of the cuts that have been slack for too long, in one
+// batch of at least CUT_PURGE_BATCH rows once CUT_PURGE_INTERVAL solves
+// have passed since the last one, or earlier when they crowd the LP, and
+// keeps the pool within its capacity
+void CutPool::purge(LPSolver& lp) {
+    vector<size_t> rows;
+    for (size_t k = 0; k < _active.size(); k++)
+        if (_cuts[_active[k]].age >= CUT_MAX_AGE)
+            rows.push_back(_baseRows + k);
+    
+    bool due = _round - _purged >= CUT_PURGE_INTERVAL || rows.size() >= CUT_PURGE_SHARE * _active.size();
+    if (rows.size() >= CUT_PURGE_BATCH && due) {
+        lp.removeRows(rows);
+        _purged = _round;
+        
+        vector<size_t> active;
+        for (size_t k = 0, r = 0; k < _active.size(); k++) {
+            if (r < rows.size() && rows[r] == _baseRows + k) {
+                _cuts[_active[k]].active = false;
+                r++;
+            }//if
+            else
+                active.push_back(_active[k]);
+        }//for
+        _active.swap(active);
+    }//if
+    
+    if (_liveCount > CUT_POOL_CAPACITY) {
+        vector<pair<long, size_t> > idle;
+        for (size_t id = 0; id < _cuts.size(); id++)
+            if (_cuts[id].live && !_cuts[id].active)
+                idle.push_back(make_pair(_cuts[id].touched, id));
+        sort(idle.begin(), idle.end());
+        for (size_t k = 0; k < idle.size() && _liveCount > CUT_POOL_CAPACITY; k++)
+            _drop(idle[k].second);
+    }//if
+}
+
+// Pool ids of the cuts in the LP, in row order after the base rows
+void CutPool::activeCuts(vector<size_t>& ids) const {
+    ids = _active;
+}
+
+// Translates a basis taken when the cuts in cuts were active to the rows
+// of the LP now: base rows and cuts still active keep their status, the
+// slacks of the other rows are basic
+void CutPool::mapBasis(const LPBasis& basis, const vector<size_t>& cuts, LPBasis& mapped) const {
+    map<size_t, size_t> position;
+    for (size_t k = 0; k < cuts.size(); k++)
+        position[cuts[k]] = _baseRows + k;
+    
+    mapped.columns = basis.columns;
+    mapped.rows.assign(basis.rows.begin(), basis.rows.begin() + min(_baseRows, basis.rows.size()));
+    for (size_t id : _active) {
+        map<size_t, size_t>::iterator it = position.find(id);
+        mapped.rows.push_back((it != position.end() && it->second < basis.rows.size()) ? basis.rows[it->second] : (char) LP_BASIC);
+    }//for
+}
+
+size_t CutPool::_row(size_t id) const {
+    return _baseRows + (find(_active.begin(), _active.end(), id) - _active.begin());
+}
+
+// The active subtour cut whose value in a solution is closest to three,
+// among those strictly between two and four; such a set splits the
+// problem into x(δ(S)) = 2 and x(δ(S)) >= 4
+bool CutPool::branchingSet(const vector<double>& vals, Cut& set) {
+    _buildSupport(vals);
+    
+    double best = 1;
+    for (size_t id : _active) {
+        const PoolCut& entry = _cuts[id];
+        if (entry.pinned || !entry.cut.teeth.empty())
+            continue;
+        double value = _supportValue(entry.cut);
+        if (value > 2 + CUT_EPSILON && value < 4 - CUT_EPSILON && fabs(value - 3) < best) {
+            best = fabs(value - 3);
+            set  = entry.cut;
+        }//if
+    }//for
+    return best < 1;
+}
+
+// Tightens the row of a subtour cut for a branch, adding the cut first
+// if needed; returns its pool id
+size_t CutPool::pin(const Cut& cut, bool atLeastFour, LPSolver& lp) {
+    add(cut, lp);
+    size_t id = _find(cut);
+    _cuts[id].pinned = true;
+    _cuts[id].age    = 0;
+    if (atLeastFour)
+        lp.setRowBounds(_row(id), cut.rhs() + 2, LP_INFINITY);
+    else
+        lp.setRowBounds(_row(id), cut.rhs(), cut.rhs());
+    return id;
+}
+
+void CutPool::release(size_t id, LPSolver& lp) {
+    _cuts[id].pinned = false;
+    _cuts[id].age    = 0;
+    lp.setRowBounds(_row(id), _cuts[id].cut.rhs(), LP_INFINITY);
+}
+
+size_t CutPool::size() const {
+    return _liveCount;
+}
+
+size_t CutPool::activeCount() const {
+    return _active.size();
+}
@@ -0,0 +1,75 @@
+//
+//  cutpool.h
+//  TSP
+//
+//  Pool of the cuts found during the search and the LP rows they occupy.
+//
+
+#ifndef __TSP__cutpool__
+#define __TSP__cutpool__
+
+#include <vector>
+#include <map>
+#include "lp.h"
+#include "separation.h"
+using namespace std;
+
+#define CUT_MAX_AGE         10
+#define CUT_POOL_CAPACITY   20000
+#define CUT_PURGE_BATCH     20
+#define CUT_PURGE_INTERVAL  10
+#define CUT_PURGE_SHARE     0.25
+
+// Every cut separated for the LP lives here as sorted node id lists. The
+// LP keeps a fixed number of base rows (the degree constraints) followed
+// by one row per active cut, in the order of _active. A cut that stays
+// non-binding for CUT_MAX_AGE solves leaves the LP but not the pool, so
+// that later solutions are checked against it before running the
+// separators again. Their rows are removed together, at most every
+// CUT_PURGE_INTERVAL solves unless they make up CUT_PURGE_SHARE of the
+// cut rows, since every removal costs the LP a refactorization. Inactive
+// cuts not seen for the longest time are dropped when the pool outgrows
+// CUT_POOL_CAPACITY. Subtour cuts that a branch tightens to x(δ(S)) = 2
+// or x(δ(S)) >= 4 are pinned: their rows stay in the LP until released.
+class CutPool : public Separator {
+private:
+    struct PoolCut {
+        Cut  cut;
+        bool live;
+        bool active;
+        bool pinned;
+        int  age;
+        long touched;
+    };
+    
+    vector<PoolCut>              _cuts;
+    vector<size_t>               _active;
+    multimap<size_t, size_t>     _hashes;
+    size_t                       _baseRows;
+    size_t                       _liveCount;
+    long                         _round;
+    long                         _purged;
+    
+    size_t _hash    (const Cut&) const;
+    size_t _find    (const Cut&) const;
+    void   _activate(size_t, LPSolver&);
+    void   _drop    (size_t);
+    size_t _row     (size_t) const;
+    
+public:
+    CutPool(Graph&, size_t);
+    
+    bool   add        (const Cut&, LPSolver&);
+    size_t separate   (const vector<double>&, size_t, LPSolver&);
+    void   age        (const vector<double>&);
+    void   purge      (LPSolver&);
+    void   activeCuts (vector<size_t>&) const;
+    void   mapBasis   (const LPBasis&, const vector<size_t>&, LPBasis&) const;
+    bool   branchingSet(const vector<double>&, Cut&);
+    size_t pin        (const Cut&, bool, LPSolver&);
+    void   release    (size_t, LPSolver&);
+    size_t size       () const;
+    size_t activeCount() const;
+};
+
+#endif /* defined(__TSP__cutpool__) */
@@ -10,20 +10,69 @@
 
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <queue>
+#include <cstring>
+#include <cstdlib>
 #include <math.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <functional>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define X86_DISTANCE_KERNELS
+#endif
 
 #define BYTE 8
+#define GRID_EPSILON 0.000001
+
+// Binary graph files start with this header. Geo graphs are followed by
+// the x and then the y coordinates as doubles; other graphs are followed
+// by their edges stored exactly as Edge objects, so a mapped file can be
+// used as the edge list in place.
+#define BINARY_MAGIC        "TSPGRAPH"
+#define BINARY_MAGIC_LEN    8
+#define BINARY_VERSION      2
+#define BINARY_BYTE_ORDER   0x01020304
+#define BINARY_KIND_EDGES   0
+#define BINARY_KIND_COORDS  1
+#define BINARY_KIND_MATRIX  2
+
+#define GEO_PI     3.141592
+#define GEO_RADIUS 6378.388
+
+struct BinaryGraphHeader {
+    char     magic[BINARY_MAGIC_LEN];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t byteOrder;
+    uint32_t edgeSize;
+    uint32_t distance;
+    uint32_t reserved;
+    uint64_t nodesCount;
+    uint64_t edgesCount;
+};
 
 void Node::init(Identifier id) {
     this->_id = id;
     this->_parentId = INVALID_ID;
+    this->x = 0;
+    this->y = 0;
 }
 
-Identifier Node::identifier() {
+Identifier Node::identifier() const {
     return _id;
 }
 
-Identifier Node::parent() {
+Identifier Node::parent() const {
     return _parentId;
 }
 
@@ -35,7 +84,7 @@ void Edge::identifier(Identifier id) {
     _id = id;
 }
 
-Identifier Edge::identifier() {
+Identifier Edge::identifier() const {
     return _id;
 }
 
@@ -45,15 +94,15 @@ Edge::Edge(Identifier source, Identifier destination, Weight weight) {
     _w   = weight;
 }
 
-Identifier Edge::source() {
+Identifier Edge::source() const {
     return _src;
 }
 
-Identifier Edge::destination() {
+Identifier Edge::destination() const {
     return _dst;
 }
 
-Identifier Edge::otherEndpoint(Identifier id) {
+Identifier Edge::otherEndpoint(Identifier id) const {
     Identifier re = INVALID_ID;
     if (id == _dst){
         re = _src;
@@ -65,7 +114,7 @@ Identifier Edge::otherEndpoint(Identifier id) {
     return re;
 }
 
-double Edge::weight() {
+double Edge::weight() const {
     return _w;
 }
 
@@ -73,9 +122,9 @@ void Edge::sort(vector<Edge>& edges) {
     std::sort(edges.begin(), edges.end(), compareEdges());
 }
 
-double Edge::sumWeights(vector<Edge> edges) {
+double Edge::sumWeights(ArrayView<Edge> edges) {
     double re = 0.0;
-    for (Edge e: edges)
+    for (const Edge& e: edges)
         re += e.weight();
     return re;
 }
@@ -91,14 +140,307 @@ int Edge::euclideEdgeLen (pair<double, double> a, pair<double, double> b) {
     return euclideEdgeLen(a.first, b.first, a.second, b.second);
 }
 
-bool compareEdges::operator() (Edge e1, Edge e2) const {
+int Edge::ceilEdgeLen(double x1, double x2, double y1, double y2) {
+    double xDist = x1 - x2;
+    double yDist = y1 - y2;
+    return (int) ceil(sqrt(xDist * xDist + yDist * yDist));
+}
+
+// Pseudo-Euclidean distance of the TSPLIB att instances
+int Edge::attEdgeLen(double x1, double x2, double y1, double y2) {
+    double xDist = x1 - x2;
+    double yDist = y1 - y2;
+    double r = sqrt((xDist * xDist + yDist * yDist) / 10.0);
+    int    t = (int) (r + 0.5);
+    return (t < r) ? t + 1 : t;
+}
+
+// Geographical distance in km; coordinates are latitude (x) and longitude
+// (y) in DDD.MM format. Degrees are truncated as in the reference code
+// used for the published TSPLIB optima.
+static double geoRadians(double v) {
+    int deg = (int) v;
+    return GEO_PI * (deg + 5.0 * (v - deg) / 3.0) / 180.0;
+}
+
+int Edge::geoEdgeLen(double x1, double x2, double y1, double y2) {
+    double lat1 = geoRadians(x1), lat2 = geoRadians(x2);
+    double lon1 = geoRadians(y1), lon2 = geoRadians(y2);
+    double q1 = cos(lon1 - lon2);
+    double q2 = cos(lat1 - lat2);
+    double q3 = cos(lat1 + lat2);
+    return (int) (GEO_RADIUS * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+}
+
+// Batched kernels computing out[i] = euclideEdgeLen(x, xs[i], y, ys[i]).
+// Vector sqrt and truncating conversion are exact like their scalar
+// counterparts, and none of the kernels fuses the multiply and add, so
+// every kernel returns the same lengths as the scalar code.
+typedef void (*DistanceKernel)(double, double, const double*, const double*, size_t, int*);
+
+static void scalarEdgeLens(double x, double y, const double* xs, const double* ys, size_t count, int* out) {
+    for (size_t i = 0; i < count; i++)
+        out[i] = Edge::euclideEdgeLen(x, xs[i], y, ys[i]);
+}
+
+#ifdef X86_DISTANCE_KERNELS
+__attribute__((target("avx")))
+static void avxEdgeLens(double x, double y, const double* xs, const double* ys, size_t count, int* out) {
+    __m256d vx   = _mm256_set1_pd(x);
+    __m256d vy   = _mm256_set1_pd(y);
+    __m256d half = _mm256_set1_pd(0.5);
+    
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(vx, _mm256_loadu_pd(xs + i));
+        __m256d dy = _mm256_sub_pd(vy, _mm256_loadu_pd(ys + i));
+        __m256d d  = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_cvttpd_epi32(_mm256_add_pd(d, half)));
+    }//for
+    scalarEdgeLens(x, y, xs + i, ys + i, count - i, out + i);
+}
+
+// AVX-512 implies FMA, so contraction is switched off to keep the
+// multiply and add (and the inlined scalar tail) rounded separately
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void avx512EdgeLens(double x, double y, const double* xs, const double* ys, size_t count, int* out) {
+    __m512d vx   = _mm512_set1_pd(x);
+    __m512d vy   = _mm512_set1_pd(y);
+    __m512d half = _mm512_set1_pd(0.5);
+    
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d dx = _mm512_sub_pd(vx, _mm512_loadu_pd(xs + i));
+        __m512d dy = _mm512_sub_pd(vy, _mm512_loadu_pd(ys + i));
+        __m512d d  = _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm512_cvttpd_epi32(_mm512_add_pd(d, half)));
+    }//for
+    scalarEdgeLens(x, y, xs + i, ys + i, count - i, out + i);
+}
+#endif
+
+static DistanceKernel selectDistanceKernel() {
+#ifdef X86_DISTANCE_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return avx512EdgeLens;
+    if (__builtin_cpu_supports("avx"))
+        return avxEdgeLens;
+#endif
+    return scalarEdgeLens;
+}
+
+void Edge::euclideEdgeLens(double x, double y, const double* xs, const double* ys, size_t count, int* out) {
+    static DistanceKernel kernel = selectDistanceKernel();
+    kernel(x, y, xs, ys, count, out);
+}
+
+bool compareEdges::operator() (const Edge& e1, const Edge& e2) const {
     return e1.weight() < e2.weight();
 }
 
+struct compareEdgeIds
+{
+    ArrayView<Edge> edges;
+    
+    compareEdgeIds(ArrayView<Edge> e) : edges(e) {}
+    bool operator() (Identifier a, Identifier b) const {
+        return edges[a].weight() < edges[b].weight();
+    }
+};
 
-Graph::Graph(bool isGeo) {
+void Adjacency::build(ArrayView<Edge> edges, size_t ncount, bool sortByWeight) {
+    size_t ecount = edges.size();
+    
+    // Count degrees and turn them into row offsets
+    _offsets.assign(ncount + 1, 0);
+    for (size_t i = 0; i < ecount; i++) {
+        _offsets[edges[i].source()      + 1]++;
+        _offsets[edges[i].destination() + 1]++;
+    }//for
+    for (size_t v = 0; v < ncount; v++)
+        _offsets[v + 1] += _offsets[v];
+    
+    // Visiting the edges in weight order fills every row already sorted,
+    // so a single global sort replaces one sort per row
+    vector<Identifier> order(ecount);
+    for (size_t i = 0; i < ecount; i++)
+        order[i] = i;
+    if (sortByWeight)
+        std::stable_sort(order.begin(), order.end(), compareEdgeIds(edges));
+    
+    _neighbors.resize(2 * ecount);
+    _edgeIds.resize(2 * ecount);
+    vector<size_t> next(_offsets.begin(), _offsets.end() - 1);
+    for (size_t k = 0; k < ecount; k++) {
+        const Edge& e = edges[order[k]];
+        size_t s = next[e.source()]++;
+        size_t d = next[e.destination()]++;
+        _neighbors[s] = e.destination();
+        _edgeIds  [s] = order[k];
+        _neighbors[d] = e.source();
+        _edgeIds  [d] = order[k];
+    }//for
+}
+
+void Adjacency::clear() {
+    _offsets.clear();
+    _neighbors.clear();
+    _edgeIds.clear();
+}
+
+bool Adjacency::empty() const {
+    return _offsets.empty();
+}
+
+size_t Adjacency::degree(Identifier id) const {
+    return _offsets[id + 1] - _offsets[id];
+}
+
+ArrayView<Identifier> Adjacency::neighbors(Identifier id) const {
+    const Identifier* base = _neighbors.data();
+    return ArrayView<Identifier>(base + _offsets[id], base + _offsets[id + 1]);
+}
+
+ArrayView<Identifier> Adjacency::edgeIds(Identifier id) const {
+    const Identifier* base = _edgeIds.data();
+    return ArrayView<Identifier>(base + _offsets[id], base + _offsets[id + 1]);
+}
+
+
+MappedFile::MappedFile(string path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw "Error in reading file!";
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw "Error in reading file!";
+    }//if
+    
+    _size = st.st_size;
+    _data = (_size > 0) ? mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (_data == MAP_FAILED)
+        throw "Error in mapping file!";
+}
+
+MappedFile::~MappedFile() {
+    if (_data)
+        munmap(_data, _size);
+}
+
+const char* MappedFile::data() const {
+    return (const char*) _data;
+}
+
+size_t MappedFile::size() const {
+    return _size;
+}
+
+SpatialGrid::SpatialGrid(const vector<double>& xlist, const vector<double>& ylist) : _x(xlist), _y(ylist) {
+    size_t ncount = _x.size();
+    
+    _minX = _minY = 0;
+    double maxX = 0, maxY = 0;
+    if (ncount > 0) {
+        _minX = maxX = _x[0];
+        _minY = maxY = _y[0];
+    }//if
+    for (size_t i = 1; i < ncount; i++) {
+        _minX = min(_minX, _x[i]); maxX = max(maxX, _x[i]);
+        _minY = min(_minY, _y[i]); maxY = max(maxY, _y[i]);
+    }//for
+    
+    // About two points per cell
+    _dim   = max((size_t)1, (size_t)ceil(sqrt(ncount / 2.0)));
+    _cellW = max((maxX - _minX) / _dim, GRID_EPSILON);
+    _cellH = max((maxY - _minY) / _dim, GRID_EPSILON);
+    
+    vector<size_t> cellOf(ncount);
+    _cellStart.assign(_dim * _dim + 1, 0);
+    for (size_t i = 0; i < ncount; i++) {
+        cellOf[i] = _cellCoord(_y[i], _minY, _cellH) * _dim + _cellCoord(_x[i], _minX, _cellW);
+        _cellStart[cellOf[i] + 1]++;
+    }//for
+    for (size_t c = 0; c < _dim * _dim; c++)
+        _cellStart[c + 1] += _cellStart[c];
+    
+    _cellPoints.resize(ncount);
+    vector<size_t> next(_cellStart.begin(), _cellStart.end() - 1);
+    for (size_t i = 0; i < ncount; i++)
+        _cellPoints[next[cellOf[i]]++] = i;
+}
+
+size_t SpatialGrid::_cellCoord(double v, double minV, double cellLen) const {
+    size_t c = (size_t)((v - minV) / cellLen);
+    return min(c, _dim - 1);
+}
+
+vector<Identifier> SpatialGrid::nearest(Identifier id, size_t k, int quadrant) const {
+    double px = _x[id], py = _y[id];
+    long   cx = _cellCoord(px, _minX, _cellW);
+    long   cy = _cellCoord(py, _minY, _cellH);
+    double cellMin = min(_cellW, _cellH);
+    
+    // Max-heap of the k best (squared distance, id) pairs seen so far
+    priority_queue<pair<double, Identifier> > best;
+    
+    for (long r = 0; r <= (long)_dim; r++) {
+        // Every point outside the rings visited so far is at least r cells away
+        double reach = (r - 1) * cellMin;
+        if (r > 0 && best.size() == k && best.top().first <= reach * reach)
+            break;
+        
+        for (long gy = cy - r; gy <= cy + r; gy++) {
+            if (gy < 0 || gy >= (long)_dim) continue;
+            bool edgeRow = (gy == cy - r || gy == cy + r);
+            for (long gx = cx - r; gx <= cx + r; gx += (edgeRow ? 1 : 2 * r)) {
+                if (gx >= 0 && gx < (long)_dim) {
+                    size_t cell = gy * _dim + gx;
+                    for (size_t p = _cellStart[cell]; p < _cellStart[cell + 1]; p++) {
+                        Identifier q = _cellPoints[p];
+                        if (q == id) continue;
+                        
+                        double dx = _x[q] - px, dy = _y[q] - py;
+                        if (quadrant != ALL_QUADRANTS &&
+                            quadrant != (dx >= 0 ? 0 : 1) + (dy >= 0 ? 0 : 2))
+                            continue;
+                        
+                        pair<double, Identifier> cand(dx * dx + dy * dy, q);
+                        if (best.size() < k)
+                            best.push(cand);
+                        else if (cand < best.top()) {
+                            best.pop();
+                            best.push(cand);
+                        }//else if
+                    }//for
+                }//if
+                if (r == 0) break;
+            }//for
+        }//for
+    }//for
+    
+    vector<Identifier> re(best.size());
+    for (size_t i = re.size(); i > 0; i--) {
+        re[i - 1] = best.top().second;
+        best.pop();
+    }//for
+    
+    return re;
+}
+
+Graph::Graph(bool isGeo, bool isImplicit) {
+    if (isImplicit && !isGeo)
+        throw "Only geo graphs can have implicit edge weights!";
+    
     _currEdge = 0;
     _isGeo = isGeo;
+    _isImplicit = isImplicit;
+    _distance = EUCLIDEAN_DISTANCE;
+    _candidatesCount = 0;
+    _quadrantCandidates = false;
 }
 
 Graph::~Graph() {
@@ -106,7 +448,7 @@ Graph::~Graph() {
     _edges.clear();
 }
 
-void Graph::_initByXY(vector<double>& xlist, vector<double>& ylist, size_t ncount) {
+void Graph::_initByXY(const vector<double>& xlist, const vector<double>& ylist, size_t ncount) {
     // Initialize nodes
     for (size_t i = 0; i < ncount; i++) {
         Node n;
@@ -116,75 +458,585 @@ void Graph::_initByXY(vector<double>& xlist, vector<double>& ylist, size_t ncoun
         _nodes.push_back(n);
     }//for
     
-    // Initialize edges
-    size_t ecount = 0;
-    for (size_t i = 0; i < ncount; i++) {
-        for (size_t j = i + 1; j < ncount; j++) {
-            Edge e(_nodes[i].identifier(), _nodes[j].identifier(),
-                   Edge::euclideEdgeLen(xlist[i], xlist[j], ylist[i], ylist[j]));
-            e.identifier(ecount++);
-            _edges.push_back(e);
-        }//for
-    }//for
+    // Implicit graphs compute weights from coordinates on demand
+    if (_candidatesCount > 0)
+        _buildCandidateSet();
+    else if (!_isImplicit)
+        materializeEdges();
 }
 
-void Graph::_readGraphFile   (string path) {
-    ifstream inputFile(path.c_str());
-    
-    if (!inputFile)
-        throw "Error in reading file!";
+void Graph::_buildCandidateSet() {
+    size_t ncount = _nodes.size();
+    vector<double> xlist(ncount), ylist(ncount);
+    for (size_t i = 0; i < ncount; i++) {
+        xlist[i] = _nodes[i].x;
+        ylist[i] = _nodes[i].y;
+    }//for
+    SpatialGrid grid(xlist, ylist);
     
-    // Read Header
-    int nodesCount, edgesCount;
-    inputFile >> nodesCount >> edgesCount;
-    _edges.reserve(edgesCount);
+    // Collect each neighbor pair once as (smaller id, larger id)
+    vector<pair<Identifier, Identifier> > pairs;
+    pairs.reserve(ncount * _candidatesCount * (_quadrantCandidates ? 2 : 1));
+    size_t perQuadrant = (_candidatesCount + 3) / 4;
+    for (size_t i = 0; i < ncount; i++) {
+        vector<Identifier> near = grid.nearest(i, _candidatesCount);
+        if (_quadrantCandidates) {
+            for (int q = 0; q < 4; q++) {
+                vector<Identifier> quad = grid.nearest(i, perQuadrant, q);
+                near.insert(near.end(), quad.begin(), quad.end());
+            }//for
+        }//if
+        for (Identifier j : near)
+            pairs.push_back(make_pair(min((Identifier)i, j), max((Identifier)i, j)));
+    }//for
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
     
-    // Read edges and their weights
-    int    src, dst;
-    Weight w;
+    _edges.clear();
+    _edges.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++) {
+        Edge e(pairs[i].first, pairs[i].second, _geoWeight(pairs[i].first, pairs[i].second));
+        e.identifier(i);
+        _edges.push_back(e);
+    }//for
     
-    //Init Nodes
-    _nodes.reserve(nodesCount);
-    for (int i = 0; i < nodesCount; i++) {
+    _adjacency.clear();
+    _sortedAdjacency.clear();
+}
+
+Weight Graph::_geoWeight(Identifier u, Identifier v) const {
+    const Node& a = _nodes[u];
+    const Node& b = _nodes[v];
+    switch (_distance) {
+        case CEIL_DISTANCE:
+            return Edge::ceilEdgeLen(a.x, b.x, a.y, b.y);
+        case ATT_DISTANCE:
+            return Edge::attEdgeLen(a.x, b.x, a.y, b.y);
+        case GEO_DISTANCE:
+            return Edge::geoEdgeLen(a.x, b.x, a.y, b.y);
+        case EUCLIDEAN_DISTANCE:
+        default:
+            return Edge::euclideEdgeLen(a.x, b.x, a.y, b.y);
+    }//switch
+}
+
+Weight Graph::_implicitWeight(Identifier u, Identifier v) const {
+    return _matrixWeights().empty() ? _geoWeight(u, v) : _matrixWeights()[_matrixIndex(u, v)];
+}
+
+// The weight matrix, in the mapping of a binary file or owned
+ArrayView<unsigned int> Graph::_matrixWeights() const {
+    return _mappedMatrix.empty() ? ArrayView<unsigned int>(_matrix) : _mappedMatrix;
+}
+
+// Position of pair (u, v) in the row-major upper triangle, which is also
+// the edge id that materializeEdges assigns to it
+size_t Graph::_matrixIndex(Identifier u, Identifier v) const {
+    if (u > v) swap(u, v);
+    size_t n = _nodes.size();
+    return u * n - (u * (u + 1)) / 2 + (v - u - 1);
+}
+
+void Graph::_initNodes(size_t ncount) {
+    _nodes.reserve(ncount);
+    for (size_t i = 0; i < ncount; i++) {
         Node v;
         v.init(i);
         v.parent(v.identifier());
         _nodes.push_back(v);
     }//for
+}
+
+// Text graph files are parsed straight from a mapping of the file. Every
+// record (an edge, or the coordinates of a node) must be on its own line;
+// blank lines are skipped. Large sections are split at line boundaries
+// and parsed by several threads: a first pass counts the records of each
+// chunk so every thread knows the index of its first record, a second
+// pass parses them into place.
+#define PARALLEL_PARSE_MIN_BYTES (1 << 20)
+#define PARSE_NUMBER_MAX_LEN     64
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static const char* skipBlanks(const char* p, const char* last) {
+    while (p < last && isBlank(*p)) p++;
+    return p;
+}
+
+static const char* parseUnsigned(const char* p, const char* last, unsigned long long& v) {
+    if (p == last || *p < '0' || *p > '9')
+        return NULL;
     
-    for (int i = 0; i < edgesCount; i++) {
-        inputFile >> src >> dst >> w;
-        addEdge(src, dst, w);
+    v = 0;
+    for (; p < last && *p >= '0' && *p <= '9'; p++) {
+        unsigned long long next = v * 10 + (*p - '0');
+        if (next / 10 != v)
+            return NULL;
+        v = next;
     }//for
+    
+    return (p == last || isBlank(*p) || *p == '\n') ? p : NULL;
 }
 
-void Graph::_readGeoGraphFile(string path) {
+static const char* parseDouble(const char* p, const char* last, double& v) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    if (p < last && *p == '+') p++;
+    from_chars_result r = from_chars(p, last, v);
+    if (r.ec != errc())
+        return NULL;
+    p = r.ptr;
+#else
+    // Without std::from_chars the token is copied so strtod cannot run
+    // past the end of the mapping
+    char   token[PARSE_NUMBER_MAX_LEN + 1];
+    size_t len = 0;
+    while (p + len < last && !isBlank(p[len]) && p[len] != '\n' && len < PARSE_NUMBER_MAX_LEN)
+        len++;
+    memcpy(token, p, len);
+    token[len] = '\0';
     
-    ifstream inputFile(path.c_str());
+    char* tokenEnd;
+    v = strtod(token, &tokenEnd);
+    if (tokenEnd == token)
+        return NULL;
+    p += tokenEnd - token;
+#endif
+    return (p == last || isBlank(*p) || *p == '\n') ? p : NULL;
+}
+
+struct TextChunk {
+    const char* first;
+    const char* last;
+    size_t      firstLine;
+    size_t      lines;
+    size_t      firstRecord;
+    size_t      records;
+    size_t      errorLine;
+    const char* error;
+};
+
+// Parses "src dst weight" lines into pre-sized edge storage
+struct EdgeRecordParser {
+    Edge*  edges;
+    size_t ncount;
     
-    if (!inputFile)
-        throw "Error in reading file!";
+    const char* operator() (const char* p, const char* eol, size_t record) const {
+        unsigned long long src, dst, w;
+        if (!(p = parseUnsigned(skipBlanks(p, eol), eol, src)) ||
+            !(p = parseUnsigned(skipBlanks(p, eol), eol, dst)) ||
+            !(p = parseUnsigned(skipBlanks(p, eol), eol, w)))
+            return "expected \"source destination weight\"";
+        if (skipBlanks(p, eol) != eol)
+            return "unexpected text after the edge";
+        if (src >= ncount || dst >= ncount)
+            return "node id out of range";
+        
+        edges[record] = Edge(src, dst, w);
+        edges[record].identifier(record);
+        return NULL;
+    }
+};
+
+// Parses "x y" lines into coordinate arrays
+struct CoordRecordParser {
+    double* xlist;
+    double* ylist;
+    
+    const char* operator() (const char* p, const char* eol, size_t record) const {
+        if (!(p = parseDouble(skipBlanks(p, eol), eol, xlist[record])) ||
+            !(p = parseDouble(skipBlanks(p, eol), eol, ylist[record])))
+            return "expected \"x y\"";
+        if (skipBlanks(p, eol) != eol)
+            return "unexpected text after the coordinates";
+        return NULL;
+    }
+};
+
+static void countRecords(TextChunk& chunk) {
+    chunk.lines = chunk.records = 0;
+    for (const char* p = chunk.first; p < chunk.last; ) {
+        const char* eol = (const char*) memchr(p, '\n', chunk.last - p);
+        if (!eol) eol = chunk.last;
+        if (skipBlanks(p, eol) != eol)
+            chunk.records++;
+        chunk.lines++;
+        p = eol + 1;
+    }//for
+}
+
+template <typename Parser>
+static void parseRecords(TextChunk& chunk, const Parser& parser) {
+    size_t line   = chunk.firstLine;
+    size_t record = chunk.firstRecord;
+    for (const char* p = chunk.first; p < chunk.last; line++) {
+        const char* eol = (const char*) memchr(p, '\n', chunk.last - p);
+        if (!eol) eol = chunk.last;
+        if (skipBlanks(p, eol) != eol) {
+            const char* error = parser(p, eol, record++);
+            if (error) {
+                chunk.error     = error;
+                chunk.errorLine = line;
+                return;
+            }//if
+        }//if
+        p = eol + 1;
+    }//for
+}
+
+static void throwParseError(string path, size_t line, const char* what) {
+    // The message outlives this call so it can be thrown like the other
+    // error strings of this file
+    static char message[512];
+    snprintf(message, sizeof(message), "%s:%zu: %s", path.c_str(), line, what);
+    throw (const char*) message;
+}
+
+// Reads the unsigned header values at the start of the file and returns
+// the position of the line following them
+static const char* parseHeader(string path, const char* p, const char* last,
+                               unsigned long long* values, size_t count, size_t& line) {
+    line = 1;
+    for (size_t i = 0; i < count; i++) {
+        while (p < last && (isBlank(*p) || *p == '\n'))
+            if (*p++ == '\n') line++;
+        if (!(p = parseUnsigned(p, last, values[i])))
+            throwParseError(path, line, "malformed header");
+    }//for
+    
+    p = skipBlanks(p, last);
+    if (p < last && *p != '\n')
+        throwParseError(path, line, "unexpected text after the header");
+    
+    line++;
+    return (p < last) ? p + 1 : p;
+}
+
+// Parses the records of [first, last), expecting exactly count of them
+template <typename Parser>
+static void parseSection(string path, const char* first, const char* last,
+                         size_t firstLine, size_t count, const Parser& parser) {
+    size_t bytes   = last - first;
+    size_t threads = 1;
+    if (bytes >= 2 * PARALLEL_PARSE_MIN_BYTES)
+        threads = max((size_t) 1, min((size_t) thread::hardware_concurrency(),
+                                      bytes / PARALLEL_PARSE_MIN_BYTES));
+    
+    // Split at line boundaries
+    vector<TextChunk> chunks(threads);
+    const char* p = first;
+    for (size_t t = 0; t < threads; t++) {
+        const char* end = (t + 1 == threads) ? last : first + (bytes * (t + 1)) / threads;
+        if (end < p) end = p;
+        const char* eol = (const char*) memchr(end, '\n', last - end);
+        end = (eol && t + 1 < threads) ? eol + 1 : last;
+        
+        chunks[t].first = p;
+        chunks[t].last  = end;
+        chunks[t].error = NULL;
+        p = end;
+    }//for
+    
+    vector<thread> workers;
+    for (size_t t = 1; t < threads; t++)
+        workers.push_back(thread(countRecords, ref(chunks[t])));
+    countRecords(chunks[0]);
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    
+    size_t line = firstLine, records = 0;
+    for (size_t t = 0; t < threads; t++) {
+        chunks[t].firstLine   = line;
+        chunks[t].firstRecord = records;
+        line    += chunks[t].lines;
+        records += chunks[t].records;
+    }//for
+    if (records != count) {
+        static char what[128];
+        snprintf(what, sizeof(what), "expected %zu records but the file has %zu", count, records);
+        throwParseError(path, line, what);
+    }//if
+    
+    workers.clear();
+    for (size_t t = 1; t < threads; t++)
+        workers.push_back(thread(parseRecords<Parser>, ref(chunks[t]), cref(parser)));
+    parseRecords(chunks[0], parser);
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    
+    // Chunks are in file order, so the first failing one has the first error
+    for (size_t t = 0; t < threads; t++)
+        if (chunks[t].error)
+            throwParseError(path, chunks[t].errorLine, chunks[t].error);
+}
+
+void Graph::_readGraphFile   (string path) {
+    MappedFile inputFile(path);
+    const char* last = inputFile.data() + inputFile.size();
+    
+    // Read Header
+    unsigned long long header[2];
+    size_t line;
+    const char* body = parseHeader(path, inputFile.data(), last, header, 2, line);
+    size_t nodesCount = header[0], edgesCount = header[1];
+    
+    //Init Nodes
+    _initNodes(nodesCount);
+    
+    // Read edges and their weights
+    _detachEdges();
+    _edges.assign(edgesCount, Edge(INVALID_ID, INVALID_ID));
+    EdgeRecordParser parser = { _edges.data(), nodesCount };
+    parseSection(path, body, last, line, edgesCount, parser);
+    
+    _adjacency.clear();
+    _sortedAdjacency.clear();
+}
+
+void Graph::_readGeoGraphFile(string path) {
+    MappedFile inputFile(path);
+    const char* last = inputFile.data() + inputFile.size();
     
     // Read Header
-    int nodesCount;
-    inputFile >> nodesCount;
+    unsigned long long nodesCount;
+    size_t line;
+    const char* body = parseHeader(path, inputFile.data(), last, &nodesCount, 1, line);
     _nodes.reserve(nodesCount);
-    _edges.reserve((nodesCount * (nodesCount - 1)) / 2);
     
     vector<double> xlist(nodesCount), ylist(nodesCount);
+    CoordRecordParser parser = { xlist.data(), ylist.data() };
+    parseSection(path, body, last, line, nodesCount, parser);
+    
+    _initByXY(xlist, ylist, xlist.size());
+}
+
+void Graph::_readBinaryGraphFile(string path) {
+    shared_ptr<MappedFile> file(new MappedFile(path));
+    
+    if (file->size() < sizeof(BinaryGraphHeader))
+        throw "Binary graph file is truncated!";
+    const BinaryGraphHeader* header = (const BinaryGraphHeader*) file->data();
+    if (header->version != BINARY_VERSION || header->byteOrder != BINARY_BYTE_ORDER)
+        throw "Binary graph file has an unsupported version or byte order!";
+    
+    size_t ncount = header->nodesCount;
+    size_t ecount = header->edgesCount;
+    const char* body = file->data() + sizeof(BinaryGraphHeader);
+    
+    if (header->kind == BINARY_KIND_COORDS) {
+        if (file->size() < sizeof(BinaryGraphHeader) + 2 * ncount * sizeof(double))
+            throw "Binary graph file is truncated!";
+        
+        const double* xs = (const double*) body;
+        vector<double> xlist(xs, xs + ncount), ylist(xs + ncount, xs + 2 * ncount);
+        _isGeo    = true;
+        _distance = (DistanceType) header->distance;
+        _initByXY(xlist, ylist, ncount);
+    }//if
+    else if (header->kind == BINARY_KIND_MATRIX) {
+        size_t pairs = ncount > 0 ? (ncount * (ncount - 1)) / 2 : 0;
+        if (file->size() < sizeof(BinaryGraphHeader) + pairs * sizeof(unsigned int))
+            throw "Binary graph file is truncated!";
+        
+        const unsigned int* ws = (const unsigned int*) body;
+        _isGeo = false;
+        _isImplicit = true;
+        _initNodes(ncount);
+        _matrix.clear();
+        _mappedMatrix = ArrayView<unsigned int>(ws, ws + pairs);
+        _mapping      = file;
+    }//else if
+    else if (header->kind == BINARY_KIND_EDGES) {
+        if (header->edgeSize != sizeof(Edge) ||
+            file->size() < sizeof(BinaryGraphHeader) + ecount * sizeof(Edge))
+            throw "Binary graph file is truncated or was written with another Edge layout!";
+        
+        _isGeo = _isImplicit = false;
+        _initNodes(ncount);
+        
+        const Edge* edges = (const Edge*) body;
+        _edges.clear();
+        _mappedEdges = ArrayView<Edge>(edges, edges + ecount);
+        _mapping     = file;
+        _adjacency.clear();
+        _sortedAdjacency.clear();
+    }//else if
+    else
+        throw "Binary graph file has an unknown kind!";
+}
+
+void Graph::writeBinaryGraphFile(string path) const {
+    ofstream outputFile(path.c_str(), ios::binary);
+    
+    if (!outputFile)
+        throw "Error in writing file!";
+    
+    BinaryGraphHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, BINARY_MAGIC_LEN);
+    header.version    = BINARY_VERSION;
+    header.byteOrder  = BINARY_BYTE_ORDER;
+    header.edgeSize   = sizeof(Edge);
+    header.distance   = _distance;
+    header.nodesCount = _nodes.size();
     
-    for (int i = 0; i < nodesCount; i++) {
-        inputFile >> xlist[i] >> ylist[i];
+    ArrayView<unsigned int> matrix = _matrixWeights();
+    if (!matrix.empty()) {
+        header.kind = BINARY_KIND_MATRIX;
+        outputFile.write((const char*) &header, sizeof(header));
+        outputFile.write((const char*) matrix.begin(), matrix.size() * sizeof(unsigned int));
+    }//if
+    else if (_isGeo) {
+        header.kind = BINARY_KIND_COORDS;
+        outputFile.write((const char*) &header, sizeof(header));
+        
+        vector<double> coords(2 * _nodes.size());
+        for (size_t i = 0; i < _nodes.size(); i++) {
+            coords[i]                 = _nodes[i].x;
+            coords[_nodes.size() + i] = _nodes[i].y;
+        }//for
+        outputFile.write((const char*) coords.data(), coords.size() * sizeof(double));
+    }//else if
+    else {
+        ArrayView<Edge> es = edges();
+        header.kind       = BINARY_KIND_EDGES;
+        header.edgesCount = es.size();
+        outputFile.write((const char*) &header, sizeof(header));
+        outputFile.write((const char*) es.begin(), es.size() * sizeof(Edge));
+    }//else
+    
+    if (!outputFile)
+        throw "Error in writing file!";
+}
+
+static string trim(const string& s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == string::npos)
+        return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+void Graph::_readTSPLIBCoords(istream& in, size_t ncount, DistanceType distance) {
+    vector<double> xlist(ncount), ylist(ncount);
+    vector<bool>   seen(ncount, false);
+    
+    for (size_t i = 0; i < ncount; i++) {
+        long long id;
+        double    x, y;
+        if (!(in >> id >> x >> y))
+            throw "TSPLIB node coordinate section is truncated!";
+        if (id < 1 || id > (long long) ncount || seen[id - 1])
+            throw "TSPLIB node coordinate section has an invalid node id!";
+        
+        seen [id - 1] = true;
+        xlist[id - 1] = x;
+        ylist[id - 1] = y;
     }//for
     
-    _initByXY(xlist, ylist, xlist.size());
+    _isGeo      = true;
+    _isImplicit = true;
+    _distance   = distance;
+    _initByXY(xlist, ylist, ncount);
+}
+
+void Graph::_readTSPLIBMatrix(istream& in, size_t ncount, string format) {
+    // Column-wise layouts of a symmetric matrix list the same numbers as
+    // the opposite row-wise layouts
+    bool full  = (format == "FULL_MATRIX");
+    bool upper = (format == "UPPER_ROW" || format == "UPPER_DIAG_ROW" ||
+                  format == "LOWER_COL" || format == "LOWER_DIAG_COL");
+    bool lower = (format == "LOWER_ROW" || format == "LOWER_DIAG_ROW" ||
+                  format == "UPPER_COL" || format == "UPPER_DIAG_COL");
+    bool diag  = (format.find("DIAG") != string::npos);
+    if (!full && !upper && !lower)
+        throw "Unsupported TSPLIB EDGE_WEIGHT_FORMAT!";
+    
+    _isGeo      = false;
+    _isImplicit = true;
+    _initNodes(ncount);
+    _matrix.assign(ncount > 0 ? (ncount * (ncount - 1)) / 2 : 0, 0);
     
-    xlist.clear();
-    ylist.clear();
+    for (size_t i = 0; i < ncount; i++) {
+        size_t first = full ? 0 : (upper ? (diag ? i : i + 1) : 0);
+        size_t last  = full ? ncount : (upper ? ncount : (diag ? i + 1 : i));
+        for (size_t j = first; j < last; j++) {
+            long long w;
+            if (!(in >> w))
+                throw "TSPLIB edge weight section is truncated!";
+            if (w < 0)
+                throw "TSPLIB edge weights must not be negative!";
+            
+            // A full matrix lists every pair twice; keep the upper entry
+            if (i < j || (!full && i != j))
+                _matrix[_matrixIndex(i, j)] = (unsigned int) w;
+        }//for
+    }//for
+}
+
+void Graph::readTSPLIBFile(string path) {
+    ifstream inputFile(path.c_str());
+    
+    if (!inputFile)
+        throw "Error in reading file!";
+    
+    size_t ncount = 0;
+    string type, weightType, weightFormat, line;
+    bool   done = false;
+    
+    while (!done && getline(inputFile, line)) {
+        size_t colon = line.find(':');
+        string key   = trim(line.substr(0, colon));
+        string value = (colon == string::npos) ? "" : trim(line.substr(colon + 1));
+        
+        if (key == "DIMENSION")
+            ncount = atol(value.c_str());
+        else if (key == "TYPE")
+            type = value;
+        else if (key == "EDGE_WEIGHT_TYPE")
+            weightType = value;
+        else if (key == "EDGE_WEIGHT_FORMAT")
+            weightFormat = value;
+        else if (key == "NODE_COORD_SECTION" || key == "EDGE_WEIGHT_SECTION") {
+            if (type != "TSP")
+                throw "Only symmetric TSPLIB instances (TYPE : TSP) are supported!";
+            if (ncount == 0)
+                throw "TSPLIB DIMENSION must precede the data section!";
+            
+            if (key == "EDGE_WEIGHT_SECTION") {
+                if (weightType != "EXPLICIT")
+                    throw "TSPLIB EDGE_WEIGHT_SECTION requires EDGE_WEIGHT_TYPE : EXPLICIT!";
+                _readTSPLIBMatrix(inputFile, ncount, weightFormat);
+            }//if
+            else if (weightType == "EUC_2D")
+                _readTSPLIBCoords(inputFile, ncount, EUCLIDEAN_DISTANCE);
+            else if (weightType == "CEIL_2D")
+                _readTSPLIBCoords(inputFile, ncount, CEIL_DISTANCE);
+            else if (weightType == "ATT")
+                _readTSPLIBCoords(inputFile, ncount, ATT_DISTANCE);
+            else if (weightType == "GEO")
+                _readTSPLIBCoords(inputFile, ncount, GEO_DISTANCE);
+            else
+                throw "Unsupported TSPLIB EDGE_WEIGHT_TYPE!";
+            done = true;
+        }//else if
+        else if (key == "EOF")
+            break;
+    }//while
+    
+    if (!done)
+        throw "TSPLIB file has no NODE_COORD_SECTION or EDGE_WEIGHT_SECTION!";
 }
 
 void Graph::readGraphFile(string path) {
-    if (_isGeo)
+    // Binary files are recognized by their magic whatever the graph kind
+    char magic[BINARY_MAGIC_LEN] = {0};
+    ifstream probe(path.c_str(), ios::binary);
+    probe.read(magic, BINARY_MAGIC_LEN);
+    if (probe && memcmp(magic, BINARY_MAGIC, BINARY_MAGIC_LEN) == 0)
+        _readBinaryGraphFile(path);
+    else if (_isGeo)
         _readGeoGraphFile(path);
     else
         _readGraphFile(path);
@@ -193,58 +1045,133 @@ void Graph::readGraphFile(string path) {
 void Graph::addEdge(Identifier src, Identifier dst, Weight w) {
     if (_isGeo)
         throw "Graph is geo graph!\nEdge cannot be added!";
+    if (!_matrixWeights().empty())
+        throw "Graph weights come from a matrix!\nEdge cannot be added!";
     
+    _detachEdges();
+
     Edge e(src, dst, w);
     e.identifier(_edges.size());
     _edges.push_back(e);
+    
+    _adjacency.clear();
+    _sortedAdjacency.clear();
 }
 
-size_t Graph::edgesCount() {
-    return _edges.size();
+void Graph::_detachEdges() {
+    // Copy a mapped edge list into owned storage before changing it
+    if (_mappedEdges.empty())
+        return;
+    
+    _edges.assign(_mappedEdges.begin(), _mappedEdges.end());
+    _mappedEdges = ArrayView<Edge>();
+    _mapping.reset();
 }
 
-size_t Graph::nodesCount() {
+size_t Graph::edgesCount() const {
+    return edges().size();
+}
+
+size_t Graph::nodesCount() const {
     return _nodes.size();
 }
 
-Node Graph::node(Identifier id) {
+const Node& Graph::node(Identifier id) const {
     return _nodes[id];
 }
 
-bool Graph::isGeo() {
+bool Graph::isGeo() const {
     return _isGeo;
 }
 
-string Graph::str() {
+bool Graph::isImplicit() const {
+    return _isImplicit;
+}
+
+DistanceType Graph::distanceType() const {
+    return _distance;
+}
+
+Weight Graph::weight(Identifier u, Identifier v) const {
+    if (!_matrixWeights().empty())
+        return _matrixWeights()[_matrixIndex(u, v)];
+    if (!_isGeo)
+        throw "Weight lookup by endpoints is only supported for geo and matrix graphs!";
+    return _geoWeight(u, v);
+}
+
+void Graph::materializeEdges() {
+    if (!_isGeo && _matrixWeights().empty())
+        throw "Only geo and matrix graphs can materialize their edges!";
+    
+    size_t ncount = _nodes.size();
+    _edges.clear();
+    _edges.reserve((ncount * (ncount - 1)) / 2);
+    
+    size_t ecount = 0;
+    if (_matrixWeights().empty() && _distance == EUCLIDEAN_DISTANCE) {
+        // Lay the coordinates out as arrays so each row goes through the
+        // batched distance kernel
+        vector<double> xlist(ncount), ylist(ncount);
+        for (size_t i = 0; i < ncount; i++) {
+            xlist[i] = _nodes[i].x;
+            ylist[i] = _nodes[i].y;
+        }//for
+        
+        vector<int> row(ncount);
+        for (size_t i = 0; i < ncount; i++) {
+            size_t rowLen = ncount - i - 1;
+            Edge::euclideEdgeLens(xlist[i], ylist[i], &xlist[i + 1], &ylist[i + 1], rowLen, row.data());
+            for (size_t j = 0; j < rowLen; j++) {
+                _edges.push_back(Edge(i, i + 1 + j, row[j]));
+                _edges.back().identifier(ecount++);
+            }//for
+        }//for
+    }//if
+    else {
+        for (size_t i = 0; i < ncount; i++) {
+            for (size_t j = i + 1; j < ncount; j++) {
+                _edges.push_back(Edge(i, j, _implicitWeight(i, j)));
+                _edges.back().identifier(ecount++);
+            }//for
+        }//for
+    }//else
+    
+    _adjacency.clear();
+    _sortedAdjacency.clear();
+}
+
+string Graph::str() const {
     stringstream ss;
     
     if (_isGeo) {
-        for (Node n : _nodes) {
+        for (const Node& n : _nodes) {
             ss << n.x << "\t" << n.y << endl;
         }//for
     }//if
     else {
-        for (Edge e: _edges)
+        for (const Edge& e: edges())
             ss << e.source() << "\t" << e.destination() << "\t" << e.weight() << endl;
     }//else
     
     return ss.str();
 }
 
-vector<Node> Graph::nodes() {
+const vector<Node>& Graph::nodes() const {
     return _nodes;
 }
 
-vector<Identifier> Graph::nodesIds() {
+vector<Identifier> Graph::nodesIds() const {
     vector<Identifier> re;
-    for(Node v : _nodes)
+    re.reserve(_nodes.size());
+    for(const Node& v : _nodes)
         re.push_back(v.identifier());
     
     return re;
 }
 
-vector<Edge> Graph::edges() {
-    return _edges;
+ArrayView<Edge> Graph::edges() const {
+    return _mappedEdges.empty() ? ArrayView<Edge>(_edges) : _mappedEdges;
 }
 
 void Graph::nodeParent(Identifier nodeId, Identifier parentId) {
@@ -257,44 +1184,61 @@ void Graph::nodeInfo(Identifier nodeId, Information info) {
     _nodes[nodeId].info = info;
 }
 
-Information Graph::nodeInfo(Identifier nodeId) {
+Information Graph::nodeInfo(Identifier nodeId) const {
     if (_isGeo)
         throw "Retreiving info of a geo graph node is not supported!";
     return _nodes[nodeId].info;
 }
 
-vector<vector<Edge> > Graph::adjancyMatrix() {
-    vector<vector<Edge> > re(this->nodesCount());
+const Adjacency& Graph::adjacency() {
+    if (_adjacency.empty())
+        _adjacency.build(edges(), _nodes.size());
     
-    for (Edge e : _edges) {
-        re[e.source()     ].push_back(e);
-        re[e.destination()].push_back(e);
-    }//for
+    return _adjacency;
+}
+
+const Adjacency& Graph::sortedAdjacency() {
+    if (_sortedAdjacency.empty())
+        _sortedAdjacency.build(edges(), _nodes.size(), true);
     
-    return re;
+    return _sortedAdjacency;
 }
 
-vector<vector<Edge> > Graph::sortedAdjancyMatrix() {
-    vector<vector<Edge> > re = adjancyMatrix();
+
+void Graph::candidateEdges(size_t k, bool quadrantNeighbors) {
+    if (!_isGeo)
+        throw "Candidate edges can only be built for geo graphs!";
     
-    for (size_t i = 0; i < re.size(); i++)
-        Edge::sort(re[i]);
+    _candidatesCount    = k;
+    _quadrantCandidates = quadrantNeighbors;
+    if (_nodes.empty())
+        return;
     
-    return re;
+    if (_candidatesCount > 0)
+        _buildCandidateSet();
+    else if (_isImplicit) {
+        _edges.clear();
+        _adjacency.clear();
+        _sortedAdjacency.clear();
+    }//else if
+    else
+        materializeEdges();
 }
 
+// Whether the edges are only the candidate set, not every pair of nodes
+bool Graph::hasCandidates() const {
+    return _candidatesCount > 0;
+}
 
-Graph Graph::makeGraph(vector<Node>& nodes) {
+Graph Graph::makeGraph(const vector<Node>& nodes) {
     Graph g(false);
-    
-    for (Node v : nodes)
-        g._nodes.push_back(v);
+    g._nodes = nodes;
     
     return g;
 }
 
-Graph Graph::makeGraph(vector<double>& xlist, vector<double>& ylist, size_t ncount) {
-    Graph g(true);
+Graph Graph::makeGraph(const vector<double>& xlist, const vector<double>& ylist, size_t ncount, bool isImplicit) {
+    Graph g(true, isImplicit);
     if (xlist.size() != ylist.size())
         throw "List of x coordinate and y coordinate must be same!";
     
@@ -303,27 +1247,31 @@ Graph Graph::makeGraph(vector<double>& xlist, vector<double>& ylist, size_t ncou
     return g;
 }
 
-Weight Graph::graphWeight(Graph& g) {
+Weight Graph::graphWeight(const Graph& g) {
     Weight re = 0;
-    for (Edge e : g.edges())
-        re += e.weight();
+    if (g.isImplicit() && g.edgesCount() == 0) {
+        size_t ncount = g.nodesCount();
+        for (size_t i = 0; i < ncount; i++)
+            for (size_t j = i + 1; j < ncount; j++)
+                re += g.weight(i, j);
+    }//if
+    else {
+        for (const Edge& e : g.edges())
+            re += e.weight();
+    }//else
     return re;
 }
 
-DisjointSets::DisjointSets(size_t count)   {
-    _elemsCount = count;
-    _ids = new Identifier[_elemsCount];
-    _ranks = new size_t[_elemsCount];
-    for(size_t i = 0; i < _elemsCount; i++)	{
-        _ids[i] = i;
-        _ranks[i] = 1;
+DisjointSets::DisjointSets(size_t count, bool undoable) : _ids(count), _sizes(count, 1), _next(count) {
+    for(size_t i = 0; i < count; i++)	{
+        _ids[i]  = i;
+        _next[i] = i;
     }//for
-    _count = _elemsCount;
+    _count    = count;
+    _undoable = undoable;
 }
  
 DisjointSets::~DisjointSets() {
-    delete _ranks;
-    delete _ids;
 }
 
 Identifier DisjointSets::find(Identifier p)	{
@@ -331,6 +1279,10 @@ Identifier DisjointSets::find(Identifier p)	{
     while (root != _ids[root])
         root = _ids[root];
     
+    // Compression would make merges impossible to undo
+    if (_undoable)
+        return root;
+    
     while (p != root) {
         Identifier newp = _ids[p];
         _ids[p] = root;
@@ -345,15 +1297,17 @@ void DisjointSets::merge(Identifier x, Identifier y)	{
     if(i == j) return;
     
     // make smaller root point to larger one
-    if(_ranks[i] < _ranks[j]) {
-        _ids[i] = j;
-        _ranks[j] += _ranks[i];
-    }//if
-    else {
-        _ids[j] = i;
-        _ranks[i] += _ranks[j];
-    }//else
+    if(_sizes[i] < _sizes[j])
+        swap(i, j);
+    _ids[j] = i;
+    _sizes[i] += _sizes[j];
+    
+    // Swapping the successors of i and j splices the two circular lists
+    swap(_next[i], _next[j]);
     _count--;
+    
+    if (_undoable)
+        _log.push_back(j);
 }
 
 bool DisjointSets::connected(Identifier x, Identifier y)    {
@@ -364,24 +1318,42 @@ size_t DisjointSets::count() {
     return _count;
 }
 
+size_t DisjointSets::checkpoint() {
+    if (!_undoable)
+        throw "Disjoint sets were not created undoable!";
+    return _log.size();
+}
+
+void DisjointSets::rollback(size_t mark) {
+    if (!_undoable)
+        throw "Disjoint sets were not created undoable!";
+    
+    while (_log.size() > mark) {
+        Identifier j = _log.back();
+        Identifier i = _ids[j];
+        _log.pop_back();
+        
+        // Undo the merge exactly: the splice is its own inverse
+        swap(_next[i], _next[j]);
+        _sizes[i] -= _sizes[j];
+        _ids[j] = j;
+        _count++;
+    }//while
+}
+
 size_t DisjointSets::setSize(Identifier id) {
-    size_t re = 0;
-    Identifier refRootId = find(id);
-    for (size_t i = 0; i < _elemsCount; i++)
-        if (find(_ids[i]) == refRootId)
-            re ++;
-    return re;
+    return _sizes[find(id)];
 }
 
 vector<Identifier> DisjointSets::set(Identifier id) {
     vector<Identifier> re;
-    re.reserve(_elemsCount);
+    re.reserve(setSize(id));
     
-    Identifier refRootId = find(id);
-    for (size_t i = 0; i < _elemsCount; i++)
-        if (find(_ids[i]) == refRootId)
-            re.push_back(i);
+    Identifier member = id;
+    do {
+        re.push_back(member);
+        member = _next[member];
+    } while (member != id);
     
     return re;
 }
-
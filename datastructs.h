@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <vector>
+#include <memory>
 using namespace std;
 
 #define INVALID_ID -1
@@ -19,6 +20,34 @@ typedef unsigned long long Weight;
 typedef long long          Identifier;
 typedef double             Information;
 
+// How the weight of a geo graph edge follows from its endpoint coordinates
+// (TSPLIB EUC_2D, CEIL_2D, ATT and GEO)
+enum DistanceType {
+    EUCLIDEAN_DISTANCE,
+    CEIL_DISTANCE,
+    ATT_DISTANCE,
+    GEO_DISTANCE
+};
+
+// Read-only view over a contiguous range owned by another object
+template <typename T>
+class ArrayView {
+private:
+    const T* _first;
+    const T* _last;
+    
+public:
+    ArrayView() : _first(NULL), _last(NULL) {}
+    ArrayView(const T* first, const T* last) : _first(first), _last(last) {}
+    ArrayView(const vector<T>& v) : _first(v.data()), _last(v.data() + v.size()) {}
+    
+    const T* begin     ()         const { return _first; }
+    const T* end       ()         const { return _last; }
+    size_t   size      ()         const { return _last - _first; }
+    bool     empty     ()         const { return _first == _last; }
+    const T& operator[](size_t i) const { return _first[i]; }
+};
+
 class Node {
 private:
     Identifier _id;
@@ -30,8 +59,8 @@ public:
     double y;
     
     void       init      (Identifier);
-    Identifier identifier();
-    Identifier parent    ();
+    Identifier identifier() const;
+    Identifier parent    () const;
     void       parent    (Identifier);
 };
 
@@ -45,75 +74,183 @@ private:
 public:
     Edge       (Identifier, Identifier, Weight = 0.0);
     void       identifier   (Identifier);
-    Identifier identifier   ();
-    Identifier source       ();
-    Identifier destination  ();
-    Identifier otherEndpoint(Identifier);
-    double     weight       ();
+    Identifier identifier   () const;
+    Identifier source       () const;
+    Identifier destination  () const;
+    Identifier otherEndpoint(Identifier) const;
+    double     weight       () const;
     
     static void   sort          (vector<Edge>&);
-    static double sumWeights    (vector<Edge>);
+    static double sumWeights    (ArrayView<Edge>);
     static int    euclideEdgeLen(double, double, double, double);
     static int    euclideEdgeLen(pair<double, double>, pair<double, double>);
+    static int    ceilEdgeLen   (double, double, double, double);
+    static int    attEdgeLen    (double, double, double, double);
+    static int    geoEdgeLen    (double, double, double, double);
+    static void   euclideEdgeLens(double, double, const double*, const double*, size_t, int*);
 };
 
 struct compareEdges
 {
-    bool operator() (Edge, Edge) const;
+    bool operator() (const Edge&, const Edge&) const;
+};
+
+// Compressed sparse row adjacency: the incident edges of node v are
+// _edgeIds[_offsets[v] .. _offsets[v + 1]), and _neighbors holds the
+// other endpoint of each of them at the same position.
+class Adjacency {
+private:
+    vector<size_t>     _offsets;
+    vector<Identifier> _neighbors;
+    vector<Identifier> _edgeIds;
+    
+public:
+    void                  build    (ArrayView<Edge>, size_t, bool = false);
+    void                  clear    ();
+    bool                  empty    () const;
+    size_t                degree   (Identifier) const;
+    ArrayView<Identifier> neighbors(Identifier) const;
+    ArrayView<Identifier> edgeIds  (Identifier) const;
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    void*  _data;
+    size_t _size;
+    
+    MappedFile           (const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+    
+public:
+    MappedFile(string);
+    ~MappedFile();
+    
+    const char* data() const;
+    size_t      size() const;
+};
+
+// Uniform grid over point coordinates used to answer nearest neighbor
+// queries without looking at every pair of points. Cells hold about two
+// points each, stored in compressed rows like Adjacency.
+class SpatialGrid {
+private:
+    vector<double>     _x;
+    vector<double>     _y;
+    vector<size_t>     _cellStart;
+    vector<Identifier> _cellPoints;
+    size_t             _dim;
+    double             _minX;
+    double             _minY;
+    double             _cellW;
+    double             _cellH;
+    
+    size_t _cellCoord(double, double, double) const;
+    
+public:
+    static const int ALL_QUADRANTS = -1;
+    
+    SpatialGrid(const vector<double>&, const vector<double>&);
+    
+    vector<Identifier> nearest(Identifier, size_t, int = ALL_QUADRANTS) const;
 };
 
 class Graph {
 private:
-    static const bool   _defIsGeo    = false;
+    static const bool   _defIsGeo      = false;
+    static const bool   _defIsImplicit = false;
     
-    vector<Node>   _nodes;
-    vector<Edge>   _edges;
-    int            _currEdge;
-    bool           _isGeo;
+    vector<Node>               _nodes;
+    vector<Edge>               _edges;
+    int                        _currEdge;
+    bool                       _isGeo;
+    bool                       _isImplicit;
+    DistanceType               _distance;
+    vector<unsigned int>       _matrix;
+    Adjacency                  _adjacency;
+    Adjacency                  _sortedAdjacency;
+    size_t                     _candidatesCount;
+    bool                       _quadrantCandidates;
+    shared_ptr<MappedFile>     _mapping;
+    ArrayView<Edge>            _mappedEdges;
+    ArrayView<unsigned int>    _mappedMatrix;
     
-    void _initByXY(vector<double>&, vector<double>&, size_t);
+    Weight _geoWeight         (Identifier, Identifier) const;
+    Weight _implicitWeight    (Identifier, Identifier) const;
+    size_t _matrixIndex       (Identifier, Identifier) const;
+    ArrayView<unsigned int> _matrixWeights() const;
+    void   _initNodes         (size_t);
+    void   _buildCandidateSet ();
+    void   _detachEdges       ();
+    
+    void _initByXY(const vector<double>&, const vector<double>&, size_t);
     void _readGraphFile   (string);
     void _readGeoGraphFile(string);
+    void _readBinaryGraphFile(string);
+    void _readTSPLIBCoords   (istream&, size_t, DistanceType);
+    void _readTSPLIBMatrix   (istream&, size_t, string);
     
 public:
-    Graph(bool = _defIsGeo);
+    Graph(bool = _defIsGeo, bool = _defIsImplicit);
+    Graph(const Graph&) = default;
+    Graph(Graph&&)      = default;
     ~Graph();
     
+    Graph& operator=(const Graph&) = default;
+    Graph& operator=(Graph&&)      = default;
+    
     void                  readGraphFile      (string);
+    void                  readTSPLIBFile     (string);
+    void                  writeBinaryGraphFile(string) const;
     void                  addEdge            (Identifier, Identifier, Weight);
-    size_t                edgesCount         ();
-    size_t                nodesCount         ();
-    Node                  node               (Identifier);
-    bool                  isGeo              ();
-    string                str                ();
-    vector<Node>          nodes              ();
-    vector<Identifier>    nodesIds           ();
-    vector<Edge>          edges              ();
+    size_t                edgesCount         () const;
+    size_t                nodesCount         () const;
+    const Node&           node               (Identifier) const;
+    bool                  isGeo              () const;
+    bool                  isImplicit         () const;
+    DistanceType          distanceType       () const;
+    Weight                weight             (Identifier, Identifier) const;
+    void                  materializeEdges   ();
+    void                  candidateEdges     (size_t, bool = false);
+    bool                  hasCandidates      () const;
+    string                str                () const;
+    const vector<Node>&   nodes              () const;
+    vector<Identifier>    nodesIds           () const;
+    ArrayView<Edge>       edges              () const;
     void                  nodeParent         (Identifier, Identifier);
     void                  nodeInfo           (Identifier, Information);
-    Information           nodeInfo           (Identifier);
-    vector<vector<Edge> > adjancyMatrix      ();
-    vector<vector<Edge> > sortedAdjancyMatrix();
+    Information           nodeInfo           (Identifier) const;
+    const Adjacency&      adjacency          ();
+    const Adjacency&      sortedAdjacency    ();
     
-    static Graph  makeGraph  (vector<Node>&);
-    static Graph  makeGraph  (vector<double>&, vector<double>&, size_t);
-    static Weight graphWeight(Graph&);
+    static Graph  makeGraph  (const vector<Node>&);
+    static Graph  makeGraph  (const vector<double>&, const vector<double>&, size_t, bool = _defIsImplicit);
+    static Weight graphWeight(const Graph&);
 };
 
+// Union-find keeping the exact size of each set at its root and the
+// members of each set on a circular list. In undoable mode merges are
+// recorded and path compression is off, so checkpoint() and rollback()
+// can undo merges in reverse order.
 class DisjointSets {
 private:
-    Identifier* _ids;
-    size_t* _ranks;
-    size_t _count;
-    size_t _elemsCount;
+    vector<Identifier> _ids;
+    vector<size_t>     _sizes;
+    vector<Identifier> _next;
+    vector<Identifier> _log;
+    size_t             _count;
+    bool               _undoable;
+    
 public:
-    DisjointSets (size_t);
+    DisjointSets (size_t, bool = false);
     ~DisjointSets();
     
-    Identifier find     (Identifier);
-    void       merge    (Identifier, Identifier);
-    bool       connected(Identifier, Identifier);
-    size_t     count    ();
+    Identifier find      (Identifier);
+    void       merge     (Identifier, Identifier);
+    bool       connected (Identifier, Identifier);
+    size_t     count     ();
+    size_t     checkpoint();
+    void       rollback  (size_t);
     
     size_t             setSize(Identifier);
     vector<Identifier> set    (Identifier);
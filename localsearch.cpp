@@ -0,0 +1,515 @@
+//
+//  localsearch.cpp
+//  TSP
+//
+//  Tour improvement by 2-opt, Or-opt and Lin-Kernighan style moves, and
+//  the rounding of LP solutions to tours.
+//
+
+#include "localsearch.h"
+#include <algorithm>
+#include <math.h>
+
+#define NO_EDGE ((size_t) -1)
+
+struct compareWeights {
+    ArrayView<Edge> edges;
+
+    compareWeights(ArrayView<Edge> e) : edges(e) {}
+    bool operator() (size_t i, size_t j) const {
+        return edges[i].weight() < edges[j].weight();
+    }
+};
+
+struct compareRounding {
+    const vector<double>& vals;
+    ArrayView<Edge>       edges;
+
+    compareRounding(const vector<double>& v, ArrayView<Edge> e) : vals(v), edges(e) {}
+    bool operator() (size_t i, size_t j) const {
+        if (vals[i] != vals[j])
+            return vals[i] > vals[j];
+        return edges[i].weight() < edges[j].weight();
+    }
+};
+
+struct compareNeighbors {
+    template <class T>
+    bool operator() (const T& a, const T& b) const {
+        return a.weight < b.weight;
+    }
+};
+
+// Builds the graph's sorted adjacency if it has none yet
+TourImprover::TourImprover(Graph& graph, LocalSearch kind) {
+    ArrayView<Edge>  edges           = graph.edges();
+    const Adjacency& sortedAdjacency = graph.sortedAdjacency();
+    size_t           ncount          = graph.nodesCount();
+    _graph  = &graph;
+    _edges  = edges;
+    _ncount = ncount;
+    _kind   = kind;
+    
+    // Only geo graphs have coordinates, and one without candidates has
+    // all its edges, whose weights the graph computes directly
+    _isGeo    = graph.isGeo();
+    _complete = _isGeo && !graph.hasCandidates();
+    if (_isGeo) {
+        _x.resize(ncount);
+        _y.resize(ncount);
+        for (size_t v = 0; v < ncount; v++) {
+            _x[v] = graph.node(v).x;
+            _y[v] = graph.node(v).y;
+        }//for
+    }//if
+
+    // A pair of nodes without an edge weighs more than any tour of edges
+    _missing = 1;
+    _byWeight.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        _byWeight[i] = i;
+        _missing     = max(_missing, edges[i].weight() + 1);
+    }//for
+    _missing *= ncount;
+    std::stable_sort(_byWeight.begin(), _byWeight.end(), compareWeights(edges));
+
+    // The edges of each node in order of weight, then, listing them again
+    // from the other end node by node, in order of that node; of parallel
+    // edges the lightest comes first and is the one found
+    vector<size_t>     start(ncount + 1, 0);
+    vector<Identifier> end(2 * edges.size());
+    vector<size_t>     of(2 * edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        start[edges[i].source() + 1]++;
+        start[edges[i].destination() + 1]++;
+    }//for
+    for (size_t v = 0; v < ncount; v++)
+        start[v + 1] += start[v];
+    _edgeStart = start;
+    for (size_t i : _byWeight) {
+        Identifier u = edges[i].source();
+        Identifier v = edges[i].destination();
+        end[start[u]] = v;
+        of[start[u]++] = i;
+        end[start[v]] = u;
+        of[start[v]++] = i;
+    }//for
+    start.assign(_edgeStart.begin(), _edgeStart.end());
+    _edgeEnd.resize(end.size());
+    _edgeOf.resize(of.size());
+    for (size_t w = 0; w < ncount; w++)
+        for (size_t k = _edgeStart[w]; k < _edgeStart[w + 1]; k++) {
+            Identifier u = end[k];
+            _edgeEnd[start[u]] = w;
+            _edgeOf[start[u]++] = of[k];
+        }//for
+    
+    // Small graphs look their weights up in a dense matrix instead
+    if (!_complete && ncount <= LS_DENSE_NODES) {
+        _dense.resize(ncount * ncount);
+        for (size_t u = 0; u < ncount; u++)
+            for (size_t v = 0; v < ncount; v++)
+                _dense[u * ncount + v] = _missing + (_isGeo ? hypot(_x[u] - _x[v], _y[u] - _y[v]) : 0.0);
+        for (size_t k = edges.size(); k-- > 0; ) {
+            size_t i = _byWeight[k];
+            Identifier u = edges[i].source();
+            Identifier v = edges[i].destination();
+            _dense[u * ncount + v] = _dense[v * ncount + u] = edges[i].weight();
+        }//for
+    }//if
+
+    _neighbors.resize(ncount);
+    for (size_t v = 0; v < ncount; v++) {
+        ArrayView<Identifier> near = sortedAdjacency.neighbors(v);
+        ArrayView<Identifier> ids  = sortedAdjacency.edgeIds(v);
+        for (size_t k = 0; k < near.size() && _neighbors[v].size() < LS_NEIGHBORS; k++) {
+            Neighbor nb = {near[k], edges[ids[k]].weight()};
+            _neighbors[v].push_back(nb);
+        }//for
+    }//for
+}
+
+size_t TourImprover::_edgeId(Identifier u, Identifier v) const {
+    vector<Identifier>::const_iterator first = _edgeEnd.begin() + _edgeStart[u];
+    vector<Identifier>::const_iterator last  = _edgeEnd.begin() + _edgeStart[u + 1];
+    vector<Identifier>::const_iterator it    = lower_bound(first, last, v);
+    return (it == last || *it != v) ? NO_EDGE : _edgeOf[it - _edgeEnd.begin()];
+}
+
+// Pairs of nodes without an edge weigh _missing, so that the moves take
+// them out of a tour first, plus their distance in the plane when there
+// are coordinates, so that the moves draw them together until an edge
+// closes them
+double TourImprover::_weight(Identifier u, Identifier v) const {
+    if (_complete)
+        return _graph->weight(u, v);
+    if (!_dense.empty())
+        return _dense[u * _ncount + v];
+    size_t id = _edgeId(u, v);
+    if (id != NO_EDGE)
+        return _edges[id].weight();
+    return _missing + (_isGeo ? hypot(_x[u] - _x[v], _y[u] - _y[v]) : 0.0);
+}
+
+Identifier TourImprover::_next(const Tour& t, Identifier v) const {
+    return t.order[(t.pos[v] + 1) % _ncount];
+}
+
+Identifier TourImprover::_prev(const Tour& t, Identifier v) const {
+    return t.order[(t.pos[v] + _ncount - 1) % _ncount];
+}
+
+void TourImprover::_activate(Tour& t, Identifier v) const {
+    if (t.dontLook[v]) {
+        t.dontLook[v] = false;
+        t.active.push_back(v);
+    }//if
+}
+
+// Reverses the path from a forward to b, or the rest of the tour when
+// that is shorter; both give the same cycle
+void TourImprover::_flip(Tour& t, Identifier a, Identifier b) const {
+    size_t n   = _ncount;
+    size_t i   = t.pos[a];
+    size_t j   = t.pos[b];
+    size_t len = (j + n - i) % n + 1;
+    if (2 * len > n) {
+        size_t first = (j + 1) % n;
+        j   = (i + n - 1) % n;
+        i   = first;
+        len = n - len;
+    }//if
+
+    for (size_t k = 0; k < len / 2; k++) {
+        Identifier u = t.order[i];
+        Identifier v = t.order[j];
+        t.order[i] = v;
+        t.pos[v]   = i;
+        t.order[j] = u;
+        t.pos[u]   = j;
+        i = (i + 1) % n;
+        j = (j + n - 1) % n;
+    }//for
+}
+
+// Replaces the tour edges (a, b) and (c, d), b following a in the
+// direction in which d follows c, by (a, c) and (b, d)
+void TourImprover::_exchange(Tour& t, Identifier a, Identifier b, Identifier c, Identifier d) const {
+    if (_next(t, a) != b) {
+        swap(a, b);
+        swap(c, d);
+    }//if
+    _flip(t, b, c);
+}
+
+// The first improving 2-opt move that removes an edge at t1
+bool TourImprover::_twoOpt(Tour& t, Identifier t1) const {
+    for (int dir = 0; dir < 2; dir++) {
+        Identifier t2  = (dir == 0) ? _next(t, t1) : _prev(t, t1);
+        double     d12 = _weight(t1, t2);
+        for (const Neighbor& nb : _neighbors[t2]) {
+            double g1 = d12 - nb.weight;
+            if (g1 <= GAIN_EPSILON) break;
+
+            Identifier t3 = nb.node;
+            Identifier t4 = (dir == 0) ? _prev(t, t3) : _next(t, t3);
+            if (t3 == t1 || t4 == t2) continue;
+            if (g1 + _weight(t3, t4) - _weight(t4, t1) > GAIN_EPSILON) {
+                _exchange(t, t1, t2, t4, t3);
+                _activate(t, t1);
+                _activate(t, t2);
+                _activate(t, t3);
+                _activate(t, t4);
+                return true;
+            }//if
+        }//for
+    }//for
+    return false;
+}
+
+// The first improving move of a path of at most OR_SEGMENT_LENGTH nodes
+// starting at s1 to an edge at a neighbor of one of its ends
+bool TourImprover::_orOpt(Tour& t, Identifier s1) const {
+    for (int dir = 0; dir < 2; dir++) {
+        bool       forward = (dir == 0);
+        Identifier p       = forward ? _prev(t, s1) : _next(t, s1);
+        Identifier s2      = s1;
+        for (size_t len = 1; len <= OR_SEGMENT_LENGTH && len + 3 <= _ncount; len++) {
+            if (len > 1)
+                s2 = forward ? _next(t, s2) : _prev(t, s2);
+            Identifier nx     = forward ? _next(t, s2) : _prev(t, s2);
+            double     remove = _weight(p, s1) + _weight(s2, nx) - _weight(p, nx);
+            if (remove <= GAIN_EPSILON) continue;
+
+            // e is the end of the segment joined to c, the other end goes
+            // to d
+            for (int end = 0; end < (len > 1 ? 2 : 1); end++) {
+                Identifier e     = (end == 0) ? s1 : s2;
+                Identifier other = (end == 0) ? s2 : s1;
+                for (const Neighbor& nb : _neighbors[e]) {
+                    if (remove - nb.weight <= GAIN_EPSILON) break;
+
+                    Identifier c = nb.node;
+                    size_t offset = forward ? (t.pos[c] + _ncount - t.pos[s1]) % _ncount : (t.pos[s1] + _ncount - t.pos[c]) % _ncount;
+                    if (offset < len) continue;
+                    for (int side = 0; side < 2; side++) {
+                        Identifier d = (side == 0) ? _next(t, c) : _prev(t, c);
+                        size_t dOffset = forward ? (t.pos[d] + _ncount - t.pos[s1]) % _ncount : (t.pos[s1] + _ncount - t.pos[d]) % _ncount;
+                        if (dOffset < len) continue;
+                        double add = nb.weight + _weight(other, d) - _weight(c, d);
+                        if (remove - add > GAIN_EPSILON)
+                            return _moveSegment(t, e, other, c, d, (end == 0) == forward);
+                    }//for
+                }//for
+            }//for
+        }//for
+    }//for
+    return false;
+}
+
+// Moves the path from first to last, walked forward or backward, between
+// the adjacent nodes c and d, first next to c
+bool TourImprover::_moveSegment(Tour& t, Identifier first, Identifier last, Identifier c, Identifier d, bool forward) const {
+    vector<Identifier> segment(1, first);
+    while (segment.back() != last)
+        segment.push_back(forward ? _next(t, segment.back()) : _prev(t, segment.back()));
+    Identifier before = forward ? _prev(t, first) : _next(t, first);
+    Identifier after  = forward ? _next(t, last) : _prev(t, last);
+
+    // The rest of the tour, walked on from after, with the segment put in
+    // again at the edge (c, d)
+    vector<Identifier> order;
+    order.reserve(_ncount);
+    Identifier u = after;
+    for (size_t k = 0; k + segment.size() < _ncount; k++) {
+        Identifier v = forward ? _next(t, u) : _prev(t, u);
+        order.push_back(u);
+        if (u == c && v == d)
+            order.insert(order.end(), segment.begin(), segment.end());
+        else if (u == d && v == c)
+            order.insert(order.end(), segment.rbegin(), segment.rend());
+        u = v;
+    }//for
+
+    t.order = order;
+    for (size_t i = 0; i < _ncount; i++)
+        t.pos[t.order[i]] = i;
+    _activate(t, before);
+    _activate(t, after);
+    _activate(t, first);
+    _activate(t, last);
+    _activate(t, c);
+    _activate(t, d);
+    return true;
+}
+
+// A chain of 2-opt moves from t1: the edge (t1, t2) is removed, t2 is
+// joined to a neighbor t3, and the edge (t3, t4) that keeps a tour when
+// t4 is joined to t1 is removed; t4 becomes the next t2. Each step takes
+// the neighbor with the largest gain, and the chain stops after LK_DEPTH
+// steps or when no gain is left. The tour after the best step is kept.
+bool TourImprover::_linKernighan(Tour& t, Identifier t1) const {
+    vector<Identifier> steps;
+    for (int dir = 0; dir < 2; dir++) {
+        Identifier t2       = (dir == 0) ? _next(t, t1) : _prev(t, t1);
+        double     g        = _weight(t1, t2);
+        double     bestGain = GAIN_EPSILON;
+        size_t     bestLen  = 0;
+        steps.clear();
+
+        for (size_t depth = 0; depth < LK_DEPTH; depth++) {
+            bool       forward = (_next(t, t1) == t2);
+            Identifier bestT3  = INVALID_ID;
+            Identifier bestT4  = INVALID_ID;
+            double     bestG   = -INFINITY;
+            for (const Neighbor& nb : _neighbors[t2]) {
+                double g1 = g - nb.weight;
+                if (g1 <= GAIN_EPSILON) break;
+
+                Identifier t3 = nb.node;
+                Identifier t4 = forward ? _prev(t, t3) : _next(t, t3);
+                if (t3 == t1 || t4 == t1 || t4 == t2) continue;
+                // A node joined earlier in the chain keeps its new edge
+                if (find(steps.begin(), steps.end(), t3) != steps.end()) continue;
+                if (g1 + _weight(t3, t4) > bestG) {
+                    bestG  = g1 + _weight(t3, t4);
+                    bestT3 = t3;
+                    bestT4 = t4;
+                }//if
+            }//for
+            if (bestT3 == INVALID_ID) break;
+
+            _exchange(t, t1, t2, bestT4, bestT3);
+            steps.push_back(t2);
+            steps.push_back(bestT3);
+            steps.push_back(bestT4);
+            g = bestG;
+            if (g - _weight(bestT4, t1) > bestGain) {
+                bestGain = g - _weight(bestT4, t1);
+                bestLen  = steps.size();
+            }//if
+            t2 = bestT4;
+        }//for
+
+        // Undo the steps after the best one
+        while (steps.size() > bestLen) {
+            Identifier u4 = steps.back(); steps.pop_back();
+            Identifier u3 = steps.back(); steps.pop_back();
+            Identifier u2 = steps.back(); steps.pop_back();
+            _exchange(t, t1, u4, u2, u3);
+        }//while
+        if (bestLen > 0) {
+            _activate(t, t1);
+            for (Identifier v : steps)
+                _activate(t, v);
+            return true;
+        }//if
+    }//for
+    return false;
+}
+
+// Improves a tour in place and returns its length, infinite if it still
+// needs a pair of nodes without an edge
+double TourImprover::improve(vector<Identifier>& tour) const {
+    if (_kind == NO_LOCAL_SEARCH || _ncount < 4)
+        return length(tour);
+
+    Tour t;
+    t.order = tour;
+    t.pos.resize(_ncount);
+    for (size_t i = 0; i < _ncount; i++)
+        t.pos[t.order[i]] = i;
+    t.dontLook.assign(_ncount, false);
+    t.active.assign(tour.rbegin(), tour.rend());
+
+    while (!t.active.empty()) {
+        Identifier v = t.active.back();
+        t.active.pop_back();
+        t.dontLook[v] = true;
+        if (_twoOpt(t, v)) continue;
+        if (_kind >= OR_OPT && _orOpt(t, v)) continue;
+        if (_kind >= LIN_KERNIGHAN)
+            _linKernighan(t, v);
+    }//while
+
+    tour = t.order;
+    return length(tour);
+}
+
+// Infinite when the tour uses a pair of nodes without an edge
+double TourImprover::length(const vector<Identifier>& tour) const {
+    double re = 0;
+    for (size_t i = 0; i < tour.size(); i++) {
+        size_t id = _edgeId(tour[i], tour[(i + 1) % tour.size()]);
+        if (id == NO_EDGE)
+            return INFINITY;
+        re += _edges[id].weight();
+    }//for
+    return re;
+}
+
+// Greedy rounding: the edges of an LP solution are taken by decreasing
+// value, and shorter first among equal values, while they keep paths;
+// then the paths are joined by the shortest edges between their ends,
+// and what is left of them is chained by distance in the plane. On a
+// sparse graph the chain may need pairs of nodes without an edge, which
+// improve() takes out again if it can. With an empty solution this is
+// the greedy edge heuristic.
+void TourImprover::roundLP(const vector<double>& vals, vector<Identifier>& tour) const {
+    size_t n = _ncount;
+    vector<size_t> order;
+    for (size_t i = 0; i < vals.size(); i++)
+        if (vals[i] > GAIN_EPSILON)
+            order.push_back(i);
+    std::sort(order.begin(), order.end(), compareRounding(vals, _edges));
+
+    vector<int>        degree(n, 0);
+    vector<Identifier> ends(2 * n, INVALID_ID);
+    DisjointSets       paths(n);
+    size_t             added = 0;
+    for (int pass = 0; pass < 2 && added + 1 < n; pass++) {
+        const vector<size_t>& edges = (pass == 0) ? order : _byWeight;
+        for (size_t k = 0; k < edges.size() && added + 1 < n; k++) {
+            Identifier u = _edges[edges[k]].source();
+            Identifier v = _edges[edges[k]].destination();
+            if (degree[u] == 2 || degree[v] == 2 || paths.connected(u, v)) continue;
+            ends[2 * u + degree[u]++] = v;
+            ends[2 * v + degree[v]++] = u;
+            paths.merge(u, v);
+            added++;
+        }//for
+    }//for
+
+    // Walk each path from one of its ends
+    vector<vector<Identifier> > chains;
+    vector<char>                visited(n, false);
+    for (Identifier u = 0; u < (Identifier) n; u++) {
+        if (visited[u] || degree[u] == 2) continue;
+        chains.push_back(vector<Identifier>());
+        Identifier prev = INVALID_ID;
+        Identifier curr = u;
+        while (curr != INVALID_ID) {
+            chains.back().push_back(curr);
+            visited[curr] = true;
+            Identifier next = (ends[2 * curr] != prev) ? ends[2 * curr] : ends[2 * curr + 1];
+            prev = curr;
+            curr = next;
+        }//while
+    }//for
+
+    // Chain the paths, each one going to the path whose nearer end is
+    // closest, in the plane for geo graphs and by weight otherwise
+    tour.clear();
+    vector<char> used(chains.size(), false);
+    for (size_t c = 0; c < chains.size(); c++) {
+        size_t next    = 0;
+        bool   reverse = false;
+        if (c > 0) {
+            double     best = INFINITY;
+            Identifier tail = tour.back();
+            for (size_t k = 0; k < chains.size(); k++) {
+                if (used[k]) continue;
+                for (int end = 0; end < 2; end++) {
+                    Identifier head = (end == 0) ? chains[k].front() : chains[k].back();
+                    double     dist = _isGeo ? hypot(_x[tail] - _x[head], _y[tail] - _y[head]) : _weight(tail, head);
+                    if (dist < best) {
+                        best    = dist;
+                        next    = k;
+                        reverse = (end == 1);
+                    }//if
+                }//for
+            }//for
+        }//if
+        used[next] = true;
+        if (reverse)
+            tour.insert(tour.end(), chains[next].rbegin(), chains[next].rend());
+        else
+            tour.insert(tour.end(), chains[next].begin(), chains[next].end());
+    }//for
+}
+
+// The 0/1 edge vector of a tour whose consecutive nodes all have edges
+void TourImprover::edgeValues(const vector<Identifier>& tour, vector<double>& vals) const {
+    vals.assign(_edges.size(), 0.0);
+    for (size_t i = 0; i < tour.size(); i++)
+        vals[_edgeId(tour[i], tour[(i + 1) % tour.size()])] = 1.0;
+}
+
+// Replaces the nearest neighbors of every node by the given candidates,
+// such as alpha-nearness lists, before the improver is shared. Candidates
+// without an edge are dropped, and the rest are kept in order of weight,
+// which the moves rely on to stop early. Empty lists change nothing.
+void TourImprover::useCandidates(const vector<vector<Identifier> >& lists) {
+    if (lists.size() != _ncount)
+        return;
+
+    for (size_t v = 0; v < _ncount; v++) {
+        _neighbors[v].clear();
+        for (Identifier u : lists[v]) {
+            if (_edgeId(v, u) == NO_EDGE) continue;
+            Neighbor nb = {u, _weight(v, u)};
+            _neighbors[v].push_back(nb);
+        }//for
+        std::sort(_neighbors[v].begin(), _neighbors[v].end(), compareNeighbors());
+    }//for
+}
@@ -0,0 +1,97 @@
+//
+//  localsearch.h
+//  TSP
+//
+//  Tour improvement by 2-opt, Or-opt and Lin-Kernighan style moves, and
+//  the rounding of LP solutions to tours.
+//
+
+#ifndef __TSP__localsearch__
+#define __TSP__localsearch__
+
+#include <vector>
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define LS_NEIGHBORS        10
+#define OR_SEGMENT_LENGTH   3
+#define LK_DEPTH            6
+#define LS_DENSE_NODES      1000
+#define GAIN_EPSILON        0.0000001
+
+enum LocalSearch {NO_LOCAL_SEARCH, TWO_OPT, OR_OPT, LIN_KERNIGHAN};
+
+// Improves tours given as node sequences until no move of the chosen
+// kind shortens them; each kind also makes the moves of the kinds before
+// it. A pair of nodes without an edge weighs more than any tour, so a
+// tour that needs some, as a rounded solution on a sparse graph may,
+// loses them first.
+// Every node looks for moves among its LS_NEIGHBORS nearest neighbors,
+// or among the candidates given to useCandidates(), and nodes whose
+// surroundings did not change since they last failed are skipped
+// (don't-look bits). The tour is an array with the position of each
+// node; a flip reverses the shorter side. Lin-Kernighan moves chain up
+// to LK_DEPTH flips and keep the best prefix of the chain.
+//
+// The improver is read-only once built, so search threads can share it.
+class TourImprover {
+private:
+    struct Neighbor {
+        Identifier node;
+        double     weight;
+    };
+
+    // The tour being improved
+    struct Tour {
+        vector<Identifier> order;
+        vector<size_t>     pos;
+        vector<char>       dontLook;
+        vector<Identifier> active;
+    };
+
+    const Graph*                         _graph;
+    ArrayView<Edge>                      _edges;
+    size_t                               _ncount;
+    LocalSearch                          _kind;
+    vector<vector<Neighbor> >            _neighbors;
+    vector<size_t>                       _byWeight;
+    double                               _missing;
+    bool                                 _isGeo;
+    bool                                 _complete;
+    vector<double>                       _x;
+    vector<double>                       _y;
+    
+    // The edges of each node sorted by the other end, for lookups by
+    // binary search: node v owns entries _edgeStart[v] to _edgeStart[v+1].
+    // Graphs of up to LS_DENSE_NODES nodes also keep all weights in a
+    // matrix
+    vector<size_t>                       _edgeStart;
+    vector<Identifier>                   _edgeEnd;
+    vector<size_t>                       _edgeOf;
+    vector<double>                       _dense;
+
+    size_t     _edgeId       (Identifier, Identifier) const;
+    double     _weight       (Identifier, Identifier) const;
+    Identifier _next         (const Tour&, Identifier) const;
+    Identifier _prev         (const Tour&, Identifier) const;
+    void       _activate     (Tour&, Identifier) const;
+    void       _flip         (Tour&, Identifier, Identifier) const;
+    void       _exchange     (Tour&, Identifier, Identifier, Identifier, Identifier) const;
+    bool       _twoOpt       (Tour&, Identifier) const;
+    bool       _orOpt        (Tour&, Identifier) const;
+    bool       _moveSegment  (Tour&, Identifier, Identifier, Identifier, Identifier, bool) const;
+    bool       _linKernighan (Tour&, Identifier) const;
+
+public:
+    TourImprover(Graph&, LocalSearch = LIN_KERNIGHAN);
+
+    double improve    (vector<Identifier>&) const;
+    double length     (const vector<Identifier>&) const;
+    void   roundLP    (const vector<double>&, vector<Identifier>&) const;
+    void   edgeValues (const vector<Identifier>&, vector<double>&) const;
+    void   useCandidates(const vector<vector<Identifier> >&);
+};
+
+#endif /* defined(__TSP__localsearch__) */
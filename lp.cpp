@@ -0,0 +1,33 @@
+//
+//  lp.cpp
+//  TSP
+//
+//  Creation of the LP backends.
+//
+
+#include "lp.h"
+#include "simplex.h"
+#include "cplexlp.h"
+
+LPSolver* LPSolver::create(LPBackend backend) {
+    if (!available(backend))
+        throw "The requested LP backend is not part of this build!";
+    
+    switch (backend) {
+#ifdef TSP_USE_CPLEX
+        case CPLEX_BACKEND:
+            return new CplexLPSolver();
+#endif
+        case SIMPLEX_BACKEND:
+        default:
+            return new DualSimplex();
+    }//switch
+}
+
+bool LPSolver::available(LPBackend backend) {
+#ifdef TSP_USE_CPLEX
+    return backend == SIMPLEX_BACKEND || backend == CPLEX_BACKEND;
+#else
+    return backend == SIMPLEX_BACKEND;
+#endif
+}
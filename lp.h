@@ -0,0 +1,79 @@
+//
+//  lp.h
+//  TSP
+//
+//  Interface between the TSP search and the linear programming solver
+//  that computes its relaxations.
+//
+
+#ifndef __TSP__lp__
+#define __TSP__lp__
+
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+#define LP_INFINITY 1e30
+
+enum LPStatus {
+    LP_OPTIMAL,
+    LP_INFEASIBLE,
+    LP_UNBOUNDED,
+    LP_ABORTED,
+    LP_ITERATION_LIMIT
+};
+
+enum LPBackend {
+    SIMPLEX_BACKEND,
+    CPLEX_BACKEND
+};
+
+enum LPVarStatus {
+    LP_BASIC,
+    LP_AT_LOWER,
+    LP_AT_UPPER
+};
+
+// Status of every column and of every row (through its slack variable).
+// A basis taken before rows were added can still be set: the slacks of
+// the newer rows are made basic.
+struct LPBasis {
+    vector<char> columns;
+    vector<char> rows;
+};
+
+// A linear program  min c'x  s.t.  lb_i <= a_i'x <= ub_i,  l <= x <= u
+// that can be changed between solves. Columns and rows are addressed by
+// the position returned when they were added; removing rows shifts the
+// rows after them down. A solve stopped by the iteration limit reports
+// LP_ITERATION_LIMIT with the objective of its last dual feasible basis,
+// a lower bound on the optimum.
+class LPSolver {
+public:
+    virtual ~LPSolver() {}
+    
+    virtual size_t   addColumn   (double, double, double) = 0;
+    virtual size_t   addRow      (const vector<size_t>&, const vector<double>&, double, double) = 0;
+    virtual void     removeRows  (const vector<size_t>&) = 0;
+    virtual void     setBounds   (size_t, double, double) = 0;
+    virtual void     setRowBounds(size_t, double, double) = 0;
+    virtual double   lowerBound  (size_t) = 0;
+    virtual double   upperBound  (size_t) = 0;
+    virtual size_t   columnsCount() = 0;
+    virtual size_t   rowsCount   () = 0;
+    
+    virtual LPStatus solve       () = 0;
+    virtual double   objValue    () = 0;
+    virtual void     primalValues(vector<double>&) = 0;
+    virtual void     dualValues  (vector<double>&) = 0;
+    virtual void     reducedCosts(vector<double>&) = 0;
+    virtual void     getBasis    (LPBasis&) = 0;
+    virtual void     setBasis    (const LPBasis&) = 0;
+    virtual long     iterations  () = 0;
+    virtual void     setIterationLimit(long) = 0;
+    
+    static LPSolver* create   (LPBackend);
+    static bool      available(LPBackend);
+};
+
+#endif /* defined(__TSP__lp__) */
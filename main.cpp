@@ -10,36 +10,92 @@
 #include <map>
 #include <string>
 #include <getopt.h>
-#include <ilcplex/ilocplex.h>
+#include <thread>
 #include "util.h"
+#include "trace.h"
 #include "tsp.h"
 using namespace std;
 
-#define POSSIBLE_OPTIONS      "b:gk:s:"
+#define POSSIBLE_OPTIONS      "ab:de:f:gh:ijk:l:mn:o:p:qr:s:tw:x:y:"
 #define SEED_OPTION           's'
+#define ONE_TREE_OPTION       'a'
+#define DETERMINISTIC_OPTION  'd'
 #define GEOMETRIC_DATA_OPTION 'g'
+#define LOCAL_SEARCH_OPTION   'h'
+#define IMPLICIT_DATA_OPTION  'i'
+#define STATS_JSON_OPTION     'j'
 #define NCOUNT_RAND_OPTION    'k'
+#define LP_BACKEND_OPTION     'l'
+#define SUBTOURS_ONLY_OPTION  'm'
+#define CANDIDATES_OPTION     'n'
+#define SELECTION_OPTION      'o'
+#define THREADS_OPTION        'p'
+#define QUADRANT_OPTION       'q'
+#define NODE_MEMORY_OPTION    'r'
+#define TSPLIB_DATA_OPTION    't'
 #define GRID_SIZE_RAND_OPTION 'b'
+#define BRANCH_RULE_OPTION    'x'
+#define DP_NODES_OPTION       'y'
+#define TIME_LIMIT_OPTION     'w'
+#define NODE_LIMIT_OPTION     'e'
+#define GAP_LIMIT_OPTION      'f'
 #define PROB_FILE_OPTION      ''
 
 #define SEED_DEFAULT           (int) Utility::realZeit()
 #define GEOMETRIC_DATA_DEFAULT false
+#define IMPLICIT_DATA_DEFAULT  false
+#define TSPLIB_DATA_DEFAULT    false
 #define NCOUNT_RAND_DEFAULT    0
+#define CANDIDATES_DEFAULT     0
+#define QUADRANT_DEFAULT       false
 #define GRID_SIZE_RAND_DEFAULT 100
+#define LP_BACKEND_DEFAULT     SIMPLEX_BACKEND
+#define SUBTOURS_ONLY_DEFAULT  false
+#define ONE_TREE_DEFAULT       false
+#define THREADS_DEFAULT        0
+#define DETERMINISTIC_DEFAULT  false
+#define SELECTION_DEFAULT      BEST_BOUND
+#define NODE_MEMORY_DEFAULT    1024
+#define BRANCH_RULE_DEFAULT    PSEUDOCOST_BRANCHING
+#define LOCAL_SEARCH_DEFAULT   LIN_KERNIGHAN
+#define DP_NODES_DEFAULT       DP_MAX_NODES
+#define TIME_LIMIT_DEFAULT     0
+#define NODE_LIMIT_DEFAULT     0
+#define GAP_LIMIT_DEFAULT      0
+#define STATS_JSON_DEFAULT     false
 
 #define PRINT_PRECISION        2
 
 void usage(string);
-bool extractArgs(int, char*[], int&, int&, int&, bool&, string&);
+bool extractArgs(int, char*[], int&, int&, int&, int&, bool&, bool&, bool&, bool&, bool&, bool&, int&, bool&, NodeSelection&, int&, BranchRule&, LocalSearch&, int&, double&, long&, double&, double&, bool&, LPBackend&, string&);
 
 int main(int argc, char * argv[]) {
     int    seed          = SEED_DEFAULT;
     bool   geometricData = GEOMETRIC_DATA_DEFAULT;
+    bool   implicitData  = IMPLICIT_DATA_DEFAULT;
+    bool   tsplibData    = TSPLIB_DATA_DEFAULT;
     int    ncountRand    = NCOUNT_RAND_DEFAULT;
     int    gridSize      = GRID_SIZE_RAND_DEFAULT;
+    int    candidates    = CANDIDATES_DEFAULT;
+    bool   quadrant      = QUADRANT_DEFAULT;
+    bool   subtoursOnly  = SUBTOURS_ONLY_DEFAULT;
+    bool   oneTree       = ONE_TREE_DEFAULT;
+    int    threads       = THREADS_DEFAULT;
+    bool   deterministic = DETERMINISTIC_DEFAULT;
+    int    nodeMemory    = NODE_MEMORY_DEFAULT;
+    NodeSelection selection = SELECTION_DEFAULT;
+    BranchRule branchRule = BRANCH_RULE_DEFAULT;
+    LocalSearch localSearch = LOCAL_SEARCH_DEFAULT;
+    int    dpNodes       = DP_NODES_DEFAULT;
+    double timeLimit     = TIME_LIMIT_DEFAULT;
+    long   nodeLimit     = NODE_LIMIT_DEFAULT;
+    double relativeGap   = GAP_LIMIT_DEFAULT;
+    double absoluteGap   = GAP_LIMIT_DEFAULT;
+    bool   statsJSON     = STATS_JSON_DEFAULT;
+    LPBackend backend    = LP_BACKEND_DEFAULT;
     string path          = "";
 
-    if (!extractArgs(argc, argv, seed, ncountRand, gridSize, geometricData, path)) {
+    if (!extractArgs(argc, argv, seed, ncountRand, gridSize, candidates, geometricData, implicitData, tsplibData, quadrant, subtoursOnly, oneTree, threads, deterministic, selection, nodeMemory, branchRule, localSearch, dpNodes, timeLimit, nodeLimit, relativeGap, absoluteGap, statsJSON, backend, path)) {
         usage(string(argv[0]));
         exit(1);
     }//if
@@ -50,29 +106,74 @@ int main(int argc, char * argv[]) {
         exit(1);
     }//if
 
+    if (!LPSolver::available(backend)) {
+        cout << "The cplex LP backend requires a build with -DTSP_USE_CPLEX\n";
+        exit(1);
+    }//if
+
     cout << "Seed = " << seed << endl;
     srandom (seed);
 
     if (path != "") {
         cout << "Problem name: " << path << endl;
-        if (geometricData)
+        if (tsplibData)
+            cout << "TSPLIB data" << endl;
+        else if (geometricData)
             cout << "Geometric data" << endl;
     }//if
 
-    Graph g(geometricData);
-    if (path != "") {
-        cout << "Reading problem file..." << endl;
-        g.readGraphFile(path);
-    }//if
-    else {
-        cout << "Building random problem..." << endl;
-        vector<double> xlist(ncountRand), ylist(ncountRand);
-        Utility::buildXY(ncountRand, gridSize, xlist, ylist);
-        g = Graph::makeGraph(xlist, ylist, ncountRand);
+    if ((implicitData || candidates > 0) && path != "" && !geometricData && !tsplibData) {
+        cout << "Implicit edge weights and candidate edges require geometric data (-g)\n";
+        usage(string(argv[0]));
+        exit(1);
     }//if
 
+    Graph g(geometricData, geometricData && implicitData);
+    // Reading or building the graph is the load phase of the statistics
+    PhaseTime load;
+    {
+        PhaseTimer timer(load, false);
+        if (path != "") {
+            cout << "Reading problem file..." << endl;
+            if (tsplibData) {
+                // TSPLIB files decide themselves whether they carry coordinates
+                g.readTSPLIBFile(path);
+                if (candidates > 0 && g.isGeo())
+                    g.candidateEdges(candidates, quadrant);
+            }//if
+            else {
+                if (candidates > 0)
+                    g.candidateEdges(candidates, quadrant);
+                g.readGraphFile(path);
+            }//else
+        }//if
+        else {
+            cout << "Building random problem..." << endl;
+            vector<double> xlist(ncountRand), ylist(ncountRand);
+            Utility::buildXY(ncountRand, gridSize, xlist, ylist);
+            g = Graph::makeGraph(xlist, ylist, ncountRand, implicitData);
+            if (candidates > 0)
+                g.candidateEdges(candidates, quadrant);
+        }//if
+    }
+
     cout << "Start to process!" << endl;
-    TravellingSalesperson tsp;
+    TravellingSalesperson tsp(backend);
+    tsp.setCombCuts(!subtoursOnly);
+    if (threads <= 0)
+        threads = max(thread::hardware_concurrency(), 1u);
+    tsp.setThreads(threads);
+    tsp.setDeterministic(deterministic);
+    tsp.setNodeSelection(selection);
+    tsp.setBranchRule(branchRule);
+    tsp.setLocalSearch(localSearch);
+    tsp.setOneTreeBound(oneTree);
+    tsp.setDPNodes((size_t) max(dpNodes, 0));
+    tsp.setNodeMemory((size_t) max(nodeMemory, 0) << 20);
+    tsp.setTimeLimit(max(timeLimit, 0.0));
+    tsp.setNodeLimit(max(nodeLimit, 0L));
+    tsp.setRelativeGap(max(relativeGap, 0.0));
+    tsp.setAbsoluteGap(max(absoluteGap, 0.0));
     vector<Edge> result = tsp.optimumTour(g);
     cout << "Finish!" << endl;
 
@@ -83,17 +184,83 @@ int main(int argc, char * argv[]) {
     cout.setf(ios::showpoint);
     cout.precision(PRINT_PRECISION);
     cout << "Running Time: " << runningTime << " sec" << endl;
-    cout << "Optimal Tour: " << tourLength  << endl;
+    switch (tsp.status()) {
+        case SOLVED_OPTIMAL:
+            cout << "Status: optimal" << endl;
+            break;
+        case CANDIDATES_OPTIMAL:
+            cout << "Status: optimal over the candidate edges only" << endl;
+            break;
+        case NO_TOUR:
+            cout << "Status: the edges of the graph hold no tour" << endl;
+            break;
+        case UNSOLVED_NODES:
+            cout << "Status: not proven optimal, " << tsp.unsolvedNodesCount() << " nodes unsolved by the LP" << endl;
+            break;
+        case TIME_LIMIT:
+            cout << "Status: time limit reached" << endl;
+            break;
+        case NODE_LIMIT:
+            cout << "Status: node limit reached" << endl;
+            break;
+        case GAP_LIMIT:
+            cout << "Status: gap limit reached" << endl;
+            break;
+    }//switch
+    if (result.empty())
+        cout << "Best Tour: none" << endl;
+    else
+        cout << (tsp.status() == SOLVED_OPTIMAL ? "Optimal Tour: " : "Best Tour: ") << tourLength << endl;
+    if (tsp.status() != NO_TOUR)
+        cout << "Lower Bound: " << tsp.finalLowerBound() << " (gap " << 100 * tsp.optimalityGap() << "%"
+             << (candidates > 0 ? ", over the candidate edges only" : "") << ")" << endl;
+    cout << "Initial Tour: " << tsp.initialTourLength() << " by " << tsp.initialHeuristic() << " (" << tsp.heuristicToursCount() << " better tours rounded from LP solutions)" << endl;
+    cout << "Root Bound: " << tsp.rootLowerBound() << " (1-tree " << tsp.oneTreeRootBound() << ")" << endl;
+    cout << "B&B Nodes: " << tsp.branchNodesCount() << " (" << tsp.treePrunesCount() << " closed by their 1-tree)" << endl;
+    cout << "Cut Pool: " << tsp.cutPoolSize() << " cuts (at most " << tsp.maxLPRows() << " LP rows)" << endl;
+    cout << "Branching: " << tsp.branchingsCount() << " decisions in " << tsp.branchingTime() << " sec ("
+         << tsp.strongSolvesCount() << " strong branching solves, " << tsp.strongIterationsCount() << " iterations)" << endl;
+    cout << "Eliminated Edges: " << tsp.eliminatedEdgesCount() << " of " << g.edgesCount() << " (" << tsp.localFixesCount() << " fixed in subtrees)" << endl;
+    cout << "Open Nodes: at most " << tsp.maxOpenNodes() << " (" << tsp.maxSpilledNodes() << " on disk)" << endl;
+    cout << "LP Solves: " << tsp.lpSolvesCount() << " (" << tsp.lpIterationsCount() << " simplex iterations, "
+         << (double) tsp.lpIterationsCount() / max(tsp.lpSolvesCount(), 1L) << " per solve)" << endl;
+
+    SolveStatistics stats = tsp.statistics();
+    stats.phases[LOAD_PHASE] += load;
+    stats.total              += load;
+    if (statsJSON)
+        stats.printJSON(cout);
+    else
+        stats.printTable(cout);
+    TRACE_WRITE(TRACE_FILE);
 
     return 0;
 }
 
 void usage (string p) {
     cerr << "Usage: " << p << " [-see below-] [prob_file]\n";
+    cerr << "   -a    bound each node by a Held-Karp 1-tree before its LP\n";
     cerr << "   -b d  gridsize d for random problems\n";
+    cerr << "   -d    deterministic parallel search (reproducible runs)\n";
+    cerr << "   -e d  stop the search after d branch and bound nodes\n";
+    cerr << "   -f g  stop the search once the gap is at most g, or g% of the tour with a trailing %\n";
     cerr << "   -g    prob_file has x-y coordinates\n" ;
+    cerr << "   -h s  tour improvement: none, 2opt, oropt or lk (default)\n";
+    cerr << "   -i    compute geometric edge weights on demand\n";
+    cerr << "   -j    print the statistics as JSON instead of a table\n";
     cerr << "   -k d  generate problem with d cities\n";
+    cerr << "   -l s  LP backend: simplex (built-in, default) or cplex\n";
+    cerr << "   -m    separate subtour constraints only (no blossoms or combs)\n";
+    cerr << "   -n d  keep only the edges to the d nearest neighbors of each city (optimal over them only)\n";
+    cerr << "   -o s  node selection: dfs, best (default), estimate or hybrid\n";
+    cerr << "   -p d  search with d threads (default: all cores)\n";
+    cerr << "   -q    with -n, also keep nearest neighbors in each quadrant\n";
+    cerr << "   -r d  megabytes of open nodes kept in memory, the rest go to disk (0: no limit)\n";
     cerr << "   -s d  random seed\n";
+    cerr << "   -t    prob_file is in TSPLIB format\n";
+    cerr << "   -w s  stop the search after s seconds, keeping the best tour found\n";
+    cerr << "   -x s  branching rule: first, most (fractional), strong, pseudo (default) or subtour\n";
+    cerr << "   -y d  solve problems of at most d cities by dynamic programming (default " << DP_MAX_NODES << ", 0: never)\n";
 }
 
 bool extractArgs(int argc,
@@ -101,7 +268,26 @@ bool extractArgs(int argc,
                  int& seed,
                  int& ncountRand,
                  int& gridSize,
+                 int& candidates,
                  bool& geometricData,
+                 bool& implicitData,
+                 bool& tsplibData,
+                 bool& quadrant,
+                 bool& subtoursOnly,
+                 bool& oneTree,
+                 int& threads,
+                 bool& deterministic,
+                 NodeSelection& selection,
+                 int& nodeMemory,
+                 BranchRule& branchRule,
+                 LocalSearch& localSearch,
+                 int& dpNodes,
+                 double& timeLimit,
+                 long& nodeLimit,
+                 double& relativeGap,
+                 double& absoluteGap,
+                 bool& statsJSON,
+                 LPBackend& backend,
                  string& path) {
     bool re = true;
     char ch;
@@ -113,12 +299,105 @@ bool extractArgs(int argc,
             case NCOUNT_RAND_OPTION:
                 ncountRand = atoi(optarg);
                 break;
+            case LP_BACKEND_OPTION:
+                if (string(optarg) == "simplex")
+                    backend = SIMPLEX_BACKEND;
+                else if (string(optarg) == "cplex")
+                    backend = CPLEX_BACKEND;
+                else
+                    re = false;
+                break;
             case GRID_SIZE_RAND_OPTION:
                 gridSize = atoi(optarg);
                 break;
+            case CANDIDATES_OPTION:
+                candidates = atoi(optarg);
+                break;
+            case QUADRANT_OPTION:
+                quadrant = true;
+                break;
+            case SUBTOURS_ONLY_OPTION:
+                subtoursOnly = true;
+                break;
+            case ONE_TREE_OPTION:
+                oneTree = true;
+                break;
+            case THREADS_OPTION:
+                threads = atoi(optarg);
+                break;
+            case DETERMINISTIC_OPTION:
+                deterministic = true;
+                break;
+            case SELECTION_OPTION:
+                if (string(optarg) == "dfs")
+                    selection = DEPTH_FIRST;
+                else if (string(optarg) == "best")
+                    selection = BEST_BOUND;
+                else if (string(optarg) == "estimate")
+                    selection = BEST_ESTIMATE;
+                else if (string(optarg) == "hybrid")
+                    selection = HYBRID_SELECTION;
+                else
+                    re = false;
+                break;
+            case NODE_MEMORY_OPTION:
+                nodeMemory = atoi(optarg);
+                break;
+            case BRANCH_RULE_OPTION:
+                if (string(optarg) == "first")
+                    branchRule = FIRST_FRACTIONAL;
+                else if (string(optarg) == "most")
+                    branchRule = MOST_FRACTIONAL;
+                else if (string(optarg) == "strong")
+                    branchRule = STRONG_BRANCHING;
+                else if (string(optarg) == "pseudo")
+                    branchRule = PSEUDOCOST_BRANCHING;
+                else if (string(optarg) == "subtour")
+                    branchRule = SUBTOUR_BRANCHING;
+                else
+                    re = false;
+                break;
+            case LOCAL_SEARCH_OPTION:
+                if (string(optarg) == "none")
+                    localSearch = NO_LOCAL_SEARCH;
+                else if (string(optarg) == "2opt")
+                    localSearch = TWO_OPT;
+                else if (string(optarg) == "oropt")
+                    localSearch = OR_OPT;
+                else if (string(optarg) == "lk")
+                    localSearch = LIN_KERNIGHAN;
+                else
+                    re = false;
+                break;
+            case DP_NODES_OPTION:
+                dpNodes = atoi(optarg);
+                break;
+            case TIME_LIMIT_OPTION:
+                timeLimit = atof(optarg);
+                break;
+            case NODE_LIMIT_OPTION:
+                nodeLimit = atol(optarg);
+                break;
+            case GAP_LIMIT_OPTION: {
+                string gap(optarg);
+                if (!gap.empty() && gap[gap.size() - 1] == '%')
+                    relativeGap = atof(gap.c_str()) / 100;
+                else
+                    absoluteGap = atof(gap.c_str());
+                break;
+            }
+            case TSPLIB_DATA_OPTION:
+                tsplibData = true;
+                break;
             case GEOMETRIC_DATA_OPTION:
                 geometricData = true;
                 break;
+            case IMPLICIT_DATA_OPTION:
+                implicitData = true;
+                break;
+            case STATS_JSON_OPTION:
+                statsJSON = true;
+                break;
             case '?':
             default:
                 re = false;
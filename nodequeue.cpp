@@ -0,0 +1,224 @@
+//
+//  nodequeue.cpp
+//  TSP
+//
+//  Open branch-and-bound nodes, ordered by a selection rule and kept
+//  within a memory budget by spilling to a temporary file.
+//
+
+#include "nodequeue.h"
+#include <unistd.h>
+
+void BranchNode::fix(Identifier id, bool select) {
+    fixes.push_back(((unsigned int) id << 1) | (select ? 1 : 0));
+}
+
+Identifier BranchNode::fixedEdge(size_t k) const {
+    return (Identifier) (fixes[k] >> 1);
+}
+
+bool BranchNode::isSelected(size_t k) const {
+    return (fixes[k] & 1) != 0;
+}
+
+void BranchNode::fixSet(const vector<Identifier>& nodes, bool atLeastFour) {
+    sets.push_back(((unsigned int) nodes.size() << 1) | (atLeastFour ? 1 : 0));
+    for (Identifier v : nodes)
+        sets.push_back((unsigned int) v);
+}
+
+// Reads the set starting at position k of sets; returns the position of
+// the next one
+size_t BranchNode::fixedSet(size_t k, vector<Identifier>& nodes, bool& atLeastFour) const {
+    size_t count = sets[k] >> 1;
+    atLeastFour  = (sets[k] & 1) != 0;
+    nodes.assign(sets.begin() + k + 1, sets.begin() + k + 1 + count);
+    return k + 1 + count;
+}
+
+// A budget of zero bytes keeps every node in memory
+NodeQueue::NodeQueue(NodeSelection selection, size_t budget) {
+    _selection = selection;
+    _budget    = budget;
+    _memory    = 0;
+    _seq       = 0;
+    _pops      = 0;
+    _diveLeft  = 0;
+    _file      = NULL;
+    _fileEnd   = 0;
+    _spilled   = 0;
+}
+
+NodeQueue::~NodeQueue() {
+    if (_file != NULL)
+        fclose(_file);
+}
+
+bool NodeQueue::_dfsOrder() const {
+    return _selection == DEPTH_FIRST;
+}
+
+// Resident nodes are spilled in the reverse of the order they will be
+// popped in
+NodeQueue::Key NodeQueue::_evictKey(const Entry& entry) const {
+    return _dfsOrder() ? entry.dive : entry.order;
+}
+
+size_t NodeQueue::_nodeBytes(const BranchNode& node) const {
+    return sizeof(Entry) + 3 * sizeof(Key)
+         + (node.fixes.size() + node.sets.size()) * sizeof(unsigned int)
+         + node.basis.columns.size() + node.basis.rows.size()
+         + node.basisCuts.size() * sizeof(size_t);
+}
+
+void NodeQueue::push(const BranchNode& node) {
+    long  seq   = _seq++;
+    Entry& entry = _entries[seq];
+    entry.node    = node;
+    entry.spilled = false;
+    entry.offset  = 0;
+    entry.bytes   = _nodeBytes(node);
+    entry.dive    = Key(-(double) node.depth, -seq);
+    switch (_selection) {
+        case BEST_ESTIMATE:
+            entry.order = Key(node.estimate, -seq);
+            break;
+        case DEPTH_FIRST:
+            entry.order = entry.dive;
+            break;
+        default:
+            entry.order = Key(node.bound, -seq);
+            break;
+    }//switch
+
+    _order.insert(entry.order);
+    _dives.insert(entry.dive);
+    _resident.insert(_evictKey(entry));
+    _memory += entry.bytes;
+    if (_budget > 0 && _memory > _budget)
+        _spill();
+}
+
+void NodeQueue::_spill() {
+    while (_memory > _budget * SPILL_TARGET && _resident.size() > 1) {
+        long   seq   = -_resident.rbegin()->second;
+        Entry& entry = _entries[seq];
+        _write(entry);
+        _resident.erase(_evictKey(entry));
+        _memory -= entry.bytes;
+    }//while
+}
+
+void NodeQueue::_write(Entry& entry) {
+    if (_file == NULL) {
+        _file = tmpfile();
+        if (_file == NULL)
+            throw "Error in creating the node file!";
+    }//if
+
+    const BranchNode& node = entry.node;
+    size_t sizes[5] = {node.fixes.size(), node.basis.columns.size(), node.basis.rows.size(), node.basisCuts.size(), node.sets.size()};
+    if (fseek(_file, _fileEnd, SEEK_SET) != 0 ||
+        fwrite(sizes, sizeof(size_t), 5, _file) != 5 ||
+        fwrite(node.fixes.data(), sizeof(unsigned int), sizes[0], _file) != sizes[0] ||
+        fwrite(node.sets.data(), sizeof(unsigned int), sizes[4], _file) != sizes[4] ||
+        fwrite(node.basis.columns.data(), sizeof(char), sizes[1], _file) != sizes[1] ||
+        fwrite(node.basis.rows.data(), sizeof(char), sizes[2], _file) != sizes[2] ||
+        fwrite(node.basisCuts.data(), sizeof(size_t), sizes[3], _file) != sizes[3])
+        throw "Error in writing the node file!";
+
+    entry.offset  = _fileEnd;
+    entry.spilled = true;
+    _fileEnd      = ftell(_file);
+    _spilled++;
+
+    // The ordering fields stay with the entry
+    entry.node.fixes     = vector<unsigned int>();
+    entry.node.sets      = vector<unsigned int>();
+    entry.node.basis     = LPBasis();
+    entry.node.basisCuts = vector<size_t>();
+}
+
+void NodeQueue::_read(Entry& entry) {
+    BranchNode& node = entry.node;
+    size_t sizes[5];
+    if (fseek(_file, entry.offset, SEEK_SET) != 0 ||
+        fread(sizes, sizeof(size_t), 5, _file) != 5)
+        throw "Error in reading the node file!";
+
+    node.fixes.resize(sizes[0]);
+    node.sets.resize(sizes[4]);
+    node.basis.columns.resize(sizes[1]);
+    node.basis.rows.resize(sizes[2]);
+    node.basisCuts.resize(sizes[3]);
+    if (fread(node.fixes.data(), sizeof(unsigned int), sizes[0], _file) != sizes[0] ||
+        fread(node.sets.data(), sizeof(unsigned int), sizes[4], _file) != sizes[4] ||
+        fread(node.basis.columns.data(), sizeof(char), sizes[1], _file) != sizes[1] ||
+        fread(node.basis.rows.data(), sizeof(char), sizes[2], _file) != sizes[2] ||
+        fread(node.basisCuts.data(), sizeof(size_t), sizes[3], _file) != sizes[3])
+        throw "Error in reading the node file!";
+
+    entry.spilled = false;
+    if (--_spilled == 0) {
+        _fileEnd = 0;
+        if (ftruncate(fileno(_file), 0) != 0)
+            throw "Error in writing the node file!";
+    }//if
+}
+
+void NodeQueue::_take(long seq, BranchNode& node) {
+    map<long, Entry>::iterator it = _entries.find(seq);
+    Entry& entry = it->second;
+    if (entry.spilled)
+        _read(entry);
+    else {
+        _resident.erase(_evictKey(entry));
+        _memory -= entry.bytes;
+    }//else
+
+    _order.erase(entry.order);
+    _dives.erase(entry.dive);
+    node = entry.node;
+    _entries.erase(it);
+}
+
+// The next node for the owner of the queue
+bool NodeQueue::pop(BranchNode& node) {
+    if (_entries.empty())
+        return false;
+
+    bool dive = _dfsOrder();
+    if (_selection == HYBRID_SELECTION) {
+        if (_diveLeft > 0) {
+            _diveLeft--;
+            dive = true;
+        }//if
+        else if (++_pops % HYBRID_DIVE_INTERVAL == 0)
+            _diveLeft = HYBRID_DIVE_LENGTH;
+    }//if
+
+    _take(-(dive ? _dives.begin()->second : _order.begin()->second), node);
+    return true;
+}
+
+// The node another worker takes: the oldest of the shallowest nodes when
+// searching depth-first, the best one otherwise
+bool NodeQueue::steal(BranchNode& node) {
+    if (_entries.empty())
+        return false;
+
+    _take(-(_dfsOrder() ? _dives.rbegin()->second : _order.begin()->second), node);
+    return true;
+}
+
+bool NodeQueue::empty() const {
+    return _entries.empty();
+}
+
+size_t NodeQueue::size() const {
+    return _entries.size();
+}
+
+size_t NodeQueue::spilledCount() const {
+    return _spilled;
+}
@@ -0,0 +1,109 @@
+//
+//  nodequeue.h
+//  TSP
+//
+//  Open branch-and-bound nodes, ordered by a selection rule and kept
+//  within a memory budget by spilling to a temporary file.
+//
+
+#ifndef __TSP__nodequeue__
+#define __TSP__nodequeue__
+
+#include <vector>
+#include <map>
+#include <set>
+#include <stdio.h>
+#include "lp.h"
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define HYBRID_DIVE_INTERVAL  10
+#define HYBRID_DIVE_LENGTH    5
+#define SPILL_TARGET          0.75
+
+enum NodeSelection {DEPTH_FIRST, BEST_BOUND, BEST_ESTIMATE, HYBRID_SELECTION};
+
+// A branch-and-bound subproblem: the bound changes on the way from the
+// root, packed as (edge id << 1 | selected), the subtour constraints
+// branched on, packed as (size << 1 | at least four) followed by the
+// node ids, the parent's LP bound and estimate, the edge branched on
+// last with the distance its value moved, and, for the worker that
+// solved the parent, the parent's optimal basis
+struct BranchNode {
+    vector<unsigned int>  fixes;
+    vector<unsigned int>  sets;
+    long                  depth;
+    double                bound;
+    double                estimate;
+    Identifier            branchEdge;
+    double                branchMove;
+    int                   owner;
+    long                  parentStamp;
+    LPBasis               basis;
+    vector<size_t>        basisCuts;
+
+    void       fix        (Identifier, bool);
+    Identifier fixedEdge  (size_t) const;
+    bool       isSelected (size_t) const;
+    void       fixSet     (const vector<Identifier>&, bool);
+    size_t     fixedSet   (size_t, vector<Identifier>&, bool&) const;
+};
+
+// Open nodes in the order of a selection rule: depth-first (newest of
+// the deepest), best bound, best estimate, or best bound with a short
+// depth-first dive every HYBRID_DIVE_INTERVAL pops. The ordering keys of
+// all nodes stay in memory; once the nodes themselves outgrow the
+// memory budget, the ones that would be popped last are written to an
+// unnamed temporary file until SPILL_TARGET of the budget is in use, and
+// read back when popped. The file is reused from its start whenever no
+// spilled node is left.
+class NodeQueue {
+private:
+    typedef pair<double, long> Key;
+
+    struct Entry {
+        BranchNode node;
+        bool       spilled;
+        long       offset;
+        size_t     bytes;
+        Key        order;
+        Key        dive;
+    };
+
+    NodeSelection       _selection;
+    size_t              _budget;
+    size_t              _memory;
+    map<long, Entry>    _entries;
+    set<Key>            _order;
+    set<Key>            _dives;
+    set<Key>            _resident;
+    long                _seq;
+    long                _pops;
+    int                 _diveLeft;
+    FILE*               _file;
+    long                _fileEnd;
+    size_t              _spilled;
+
+    bool   _dfsOrder  () const;
+    Key    _evictKey  (const Entry&) const;
+    size_t _nodeBytes (const BranchNode&) const;
+    void   _spill     ();
+    void   _write     (Entry&);
+    void   _read      (Entry&);
+    void   _take      (long, BranchNode&);
+
+public:
+    NodeQueue(NodeSelection = BEST_BOUND, size_t = 0);
+    ~NodeQueue();
+
+    void   push         (const BranchNode&);
+    bool   pop          (BranchNode&);
+    bool   steal        (BranchNode&);
+    bool   empty        () const;
+    size_t size         () const;
+    size_t spilledCount () const;
+};
+
+#endif /* defined(__TSP__nodequeue__) */
@@ -0,0 +1,241 @@
+//
+//  onetree.cpp
+//  TSP
+//
+//  Held-Karp lower bounds from minimum 1-trees with node penalties, and
+//  alpha-nearness candidate lists.
+//
+
+#include "onetree.h"
+#include <algorithm>
+#include <math.h>
+
+#define SORTED_PER_NODE  8
+
+struct compareCosts {
+    const vector<double>& costs;
+
+    compareCosts(const vector<double>& c) : costs(c) {}
+    bool operator() (size_t i, size_t j) const {
+        return costs[i] < costs[j];
+    }
+};
+
+OneTreeBound::OneTreeBound(Graph& graph) {
+    _edges  = graph.edges();
+    _ncount = graph.nodesCount();
+}
+
+double OneTreeBound::_cost(size_t e, const vector<double>& pi) const {
+    return _edges[e].weight() + pi[_edges[e].source()] + pi[_edges[e].destination()];
+}
+
+// Shortest 1-tree under the penalties that keeps the fixes; returns its
+// penalized length, or INFINITY when the fixes leave no 1-tree, and then
+// no tour either. A tree rarely needs more than the cheapest
+// SORTED_PER_NODE edges per node, so only those are sorted first.
+double OneTreeBound::_minimum(const vector<double>& pi, const vector<int>& fixed, OneTree& tree) const {
+    size_t n = _ncount;
+    tree.edges.clear();
+    tree.degree.assign(n, 0);
+    if (n < 3)
+        return INFINITY;
+
+    // The edges fixed in first
+    DisjointSets sets(n);
+    size_t       specials = 0;
+    for (size_t e = 0; e < _edges.size(); e++) {
+        Identifier u = _edges[e].source();
+        Identifier v = _edges[e].destination();
+        if (fixed[e] != 1 || u == v) continue;
+        if (u == ONE_TREE_SPECIAL || v == ONE_TREE_SPECIAL) {
+            if (specials == 2)
+                return INFINITY;
+            tree.special[specials++] = e;
+        }//if
+        else if (sets.connected(u, v))
+            return INFINITY;
+        else {
+            sets.merge(u, v);
+            tree.edges.push_back(e);
+        }//else
+    }//for
+
+    // Then the free ones by cost
+    vector<double> costs(_edges.size());
+    vector<size_t> order;
+    for (size_t e = 0; e < _edges.size(); e++)
+        if (fixed[e] != 0 && fixed[e] != 1) {
+            costs[e] = _cost(e, pi);
+            order.push_back(e);
+        }//if
+    size_t sorted = min(order.size(), n * SORTED_PER_NODE);
+    std::nth_element(order.begin(), order.begin() + sorted, order.end(), compareCosts(costs));
+    std::sort(order.begin(), order.begin() + sorted, compareCosts(costs));
+    for (size_t k = 0; k < order.size() && (tree.edges.size() + 2 < n || specials < 2); k++) {
+        if (k == sorted) {
+            std::sort(order.begin() + sorted, order.end(), compareCosts(costs));
+            sorted = order.size();
+        }//if
+        size_t     e = order[k];
+        Identifier u = _edges[e].source();
+        Identifier v = _edges[e].destination();
+        if (u == v) continue;
+        if (u == ONE_TREE_SPECIAL || v == ONE_TREE_SPECIAL) {
+            if (specials < 2)
+                tree.special[specials++] = e;
+        }//if
+        else if (!sets.connected(u, v)) {
+            sets.merge(u, v);
+            tree.edges.push_back(e);
+        }//else if
+    }//for
+    if (tree.edges.size() + 2 < n || specials < 2)
+        return INFINITY;
+
+    double length = 0;
+    for (size_t e : tree.edges) {
+        length += _cost(e, pi);
+        tree.degree[_edges[e].source()]++;
+        tree.degree[_edges[e].destination()]++;
+    }//for
+    for (int s = 0; s < 2; s++) {
+        length += _cost(tree.special[s], pi);
+        tree.degree[_edges[tree.special[s]].source()]++;
+        tree.degree[_edges[tree.special[s]].destination()]++;
+    }//for
+    for (size_t v = 0; v < n; v++)
+        length -= 2 * pi[v];
+    return length;
+}
+
+// Subgradient ascent from the penalties pi towards the target, usually
+// the incumbent; stops once the bound exceeds the target, after the
+// given number of 1-trees, or when the step has shrunk below
+// HK_MIN_STEP. Leaves the best penalties in pi and returns the best
+// bound, INFINITY if the fixes leave no tour. When a 1-tree is a tour,
+// which is then the shortest one under the fixes, its nodes are left in
+// tour; otherwise tour is empty.
+double OneTreeBound::ascent(vector<double>& pi, const vector<int>& fixed, double target, size_t iterations, vector<Identifier>& tour) const {
+    OneTree        tree;
+    vector<double> best   = pi;
+    double         bound  = -INFINITY;
+    double         lambda = HK_INITIAL_STEP;
+    size_t         stall  = 0;
+    tour.clear();
+    for (size_t k = 0; k < iterations && lambda >= HK_MIN_STEP; k++) {
+        double length = _minimum(pi, fixed, tree);
+        if (length == INFINITY)
+            return INFINITY;
+        if (length > bound) {
+            bound = length;
+            best  = pi;
+            stall = 0;
+        }//if
+        else if (++stall >= HK_STALL) {
+            lambda /= 2;
+            stall   = 0;
+        }//else if
+
+        double norm = 0;
+        for (size_t v = 0; v < _ncount; v++)
+            norm += (tree.degree[v] - 2) * (tree.degree[v] - 2);
+        if (norm == 0) {
+            // Walk the tour from the special node
+            vector<vector<Identifier> > links(_ncount);
+            tree.edges.push_back(tree.special[0]);
+            tree.edges.push_back(tree.special[1]);
+            for (size_t e : tree.edges) {
+                links[_edges[e].source()].push_back(_edges[e].destination());
+                links[_edges[e].destination()].push_back(_edges[e].source());
+            }//for
+            Identifier prev = ONE_TREE_SPECIAL;
+            Identifier curr = links[ONE_TREE_SPECIAL][0];
+            tour.assign(1, ONE_TREE_SPECIAL);
+            while (curr != ONE_TREE_SPECIAL) {
+                tour.push_back(curr);
+                Identifier next = (links[curr][0] == prev) ? links[curr][1] : links[curr][0];
+                prev = curr;
+                curr = next;
+            }//while
+            pi = best;
+            return bound;
+        }//if
+        if (bound > target + HK_EPSILON)
+            break;
+
+        double goal = (target < INFINITY) ? target : bound + fabs(bound) * 0.1 + 1;
+        double step = lambda * max(goal - length, HK_EPSILON) / norm;
+        for (size_t v = 0; v < _ncount; v++)
+            pi[v] += step * (tree.degree[v] - 2);
+    }//for
+    pi = best;
+    return bound;
+}
+
+// The k edges at each node with the smallest alpha-nearness under the
+// penalties: the growth of the shortest 1-tree when it has to contain
+// the edge, that is the edge's cost less the dearest edge on the tree
+// path it closes, or less the dearer special edge at the special node.
+// Ties go to the shorter edge. O(n^2), so graphs with more than
+// ALPHA_MAX_NODES nodes get no lists.
+void OneTreeBound::alphaNeighbors(const vector<double>& pi, size_t k, vector<vector<Identifier> >& lists) const {
+    OneTree        tree;
+    vector<int>    unfixed(_edges.size(), -1);
+    lists.clear();
+    if (_ncount > ALPHA_MAX_NODES || _minimum(pi, unfixed, tree) == INFINITY)
+        return;
+
+    size_t n = _ncount;
+    vector<vector<size_t> >                     incident(n);
+    vector<vector<pair<Identifier, double> > > links(n);
+    for (size_t e = 0; e < _edges.size(); e++) {
+        incident[_edges[e].source()].push_back(e);
+        if (_edges[e].destination() != _edges[e].source())
+            incident[_edges[e].destination()].push_back(e);
+    }//for
+    for (size_t e : tree.edges) {
+        double c = _cost(e, pi);
+        links[_edges[e].source()].push_back(make_pair(_edges[e].destination(), c));
+        links[_edges[e].destination()].push_back(make_pair(_edges[e].source(), c));
+    }//for
+    double specialMax = max(_cost(tree.special[0], pi), _cost(tree.special[1], pi));
+
+    lists.resize(n);
+    vector<double>                                  beta(n);
+    vector<char>                                    seen(n);
+    vector<Identifier>                              stack;
+    vector<pair<pair<double, double>, Identifier> > ranked;
+    for (Identifier u = 0; u < (Identifier) n; u++) {
+        // Dearest tree edge on the path from u to every node
+        if (u != ONE_TREE_SPECIAL) {
+            seen.assign(n, false);
+            seen[u] = true;
+            beta[u] = -INFINITY;
+            stack.assign(1, u);
+            while (!stack.empty()) {
+                Identifier v = stack.back();
+                stack.pop_back();
+                for (const pair<Identifier, double>& l : links[v])
+                    if (!seen[l.first]) {
+                        seen[l.first] = true;
+                        beta[l.first] = max(beta[v], l.second);
+                        stack.push_back(l.first);
+                    }//if
+            }//while
+        }//if
+
+        ranked.clear();
+        for (size_t e : incident[u]) {
+            Identifier v = _edges[e].otherEndpoint(u);
+            if (v == u) continue;
+            double c     = _cost(e, pi);
+            double alpha = (u == ONE_TREE_SPECIAL || v == ONE_TREE_SPECIAL) ? c - specialMax : c - beta[v];
+            ranked.push_back(make_pair(make_pair(max(alpha, 0.0), _edges[e].weight()), v));
+        }//for
+        size_t keep = min(k, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end());
+        for (size_t j = 0; j < keep; j++)
+            lists[u].push_back(ranked[j].second);
+    }//for
+}
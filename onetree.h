@@ -0,0 +1,61 @@
+//
+//  onetree.h
+//  TSP
+//
+//  Held-Karp lower bounds from minimum 1-trees with node penalties, and
+//  alpha-nearness candidate lists.
+//
+
+#ifndef __TSP__onetree__
+#define __TSP__onetree__
+
+#include <vector>
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define ONE_TREE_SPECIAL      0
+#define HK_ROOT_ITERATIONS    300
+#define HK_NODE_ITERATIONS    10
+#define HK_INITIAL_STEP       2.0
+#define HK_MIN_STEP           0.001
+#define HK_STALL              5
+#define HK_EPSILON            0.000001
+#define ALPHA_MAX_NODES       10000
+
+// A 1-tree is a spanning tree of all nodes but ONE_TREE_SPECIAL plus two
+// edges at that node; every tour is one, so the shortest 1-tree under
+// edge weights w_uv + pi_u + pi_v, less twice the sum of the penalties
+// pi, bounds the tour length from below. ascent() raises the bound by
+// subgradient steps that push the node degrees towards 2 (Held and
+// Karp, with Polyak's step towards a target, halved when the bound
+// stalls).
+//
+// Edge fixes follow the encoding of the search: fixed[e] is 0 for an
+// edge fixed out, 1 for an edge fixed in, and anything else for a free
+// one. Trees are built by Kruskal's algorithm on DisjointSets, the edges
+// fixed in first. The object is read-only once built, so search threads
+// can share it.
+class OneTreeBound {
+private:
+    struct OneTree {
+        vector<size_t> edges;
+        size_t         special[2];
+        vector<int>    degree;
+    };
+
+    ArrayView<Edge>  _edges;
+    size_t           _ncount;
+
+    double _cost    (size_t, const vector<double>&) const;
+    double _minimum (const vector<double>&, const vector<int>&, OneTree&) const;
+
+public:
+    OneTreeBound(Graph&);
+
+    double ascent        (vector<double>&, const vector<int>&, double, size_t, vector<Identifier>&) const;
+    void   alphaNeighbors(const vector<double>&, size_t, vector<vector<Identifier> >&) const;
+};
+
+#endif /* defined(__TSP__onetree__) */
@@ -0,0 +1,479 @@
+//
+//  separation.cpp
+//  TSP
+//
+//  Separation of inequalities violated by fractional LP solutions.
+//
+
+#include "separation.h"
+#include <algorithm>
+#include <set>
+#include <queue>
+#include <utility>
+#include <math.h>
+
+#define FLOW_INFINITY    1e30
+#define COST_INFINITY    1e30
+
+// Dinic's maximum flow on an undirected graph with real capacities
+class MaxFlow {
+private:
+    struct Arc {
+        size_t to;
+        double cap;
+    };
+    
+    vector<vector<size_t> > _out;
+    vector<Arc>             _arcs;
+    vector<double>          _caps;
+    vector<int>             _level;
+    vector<size_t>          _next;
+    
+    bool _bfs(size_t s, size_t t) {
+        _level.assign(_out.size(), -1);
+        queue<size_t> q;
+        _level[s] = 0;
+        q.push(s);
+        while (!q.empty()) {
+            size_t v = q.front();
+            q.pop();
+            for (size_t a : _out[v]) {
+                if (_arcs[a].cap > CUT_EPSILON / 100 && _level[_arcs[a].to] < 0) {
+                    _level[_arcs[a].to] = _level[v] + 1;
+                    q.push(_arcs[a].to);
+                }//if
+            }//for
+        }//while
+        return _level[t] >= 0;
+    }
+    
+    double _dfs(size_t v, size_t t, double pushed) {
+        if (v == t) return pushed;
+        for (; _next[v] < _out[v].size(); _next[v]++) {
+            size_t a = _out[v][_next[v]];
+            size_t w = _arcs[a].to;
+            if (_arcs[a].cap <= CUT_EPSILON / 100 || _level[w] != _level[v] + 1) continue;
+            double f = _dfs(w, t, min(pushed, _arcs[a].cap));
+            if (f > 0) {
+                _arcs[a].cap     -= f;
+                _arcs[a ^ 1].cap += f;
+                return f;
+            }//if
+        }//for
+        return 0;
+    }
+    
+public:
+    MaxFlow(size_t n) : _out(n) {}
+    
+    void addEdge(size_t u, size_t v, double cap) {
+        _out[u].push_back(_arcs.size());
+        _arcs.push_back({v, cap});
+        _out[v].push_back(_arcs.size());
+        _arcs.push_back({u, cap});
+        _caps.push_back(cap);
+        _caps.push_back(cap);
+    }
+    
+    // Maximum s-t flow from scratch; sourceSide marks the source side of
+    // a minimum cut
+    double solve(size_t s, size_t t, vector<char>& sourceSide) {
+        for (size_t a = 0; a < _arcs.size(); a++)
+            _arcs[a].cap = _caps[a];
+        
+        double flow = 0;
+        while (_bfs(s, t)) {
+            _next.assign(_out.size(), 0);
+            while (double f = _dfs(s, t, FLOW_INFINITY))
+                flow += f;
+        }//while
+        
+        sourceSide.assign(_out.size(), 0);
+        for (size_t v = 0; v < _out.size(); v++)
+            sourceSide[v] = _level[v] >= 0;
+        return flow;
+    }
+};
+
+Separator::Separator(Graph& graph) : _graph(&graph), _ncount(graph.nodesCount()) {
+    _inSet.assign(_ncount, 0);
+}
+
+void Separator::_buildSupport(const vector<double>& vals) {
+    ArrayView<Edge> edges = _graph->edges();
+    _support.assign(_ncount, vector<SupportEdge>());
+    
+    for (size_t i = 0; i < vals.size(); i++) {
+        if (vals[i] <= SUPPORT_EPSILON) continue;
+        Identifier u = edges[i].source();
+        Identifier v = edges[i].destination();
+        _support[u].push_back({v, i, vals[i]});
+        _support[v].push_back({u, i, vals[i]});
+    }//for
+}
+
+// Gomory-Hu tree of the graph on m nodes with the edges (us[k], vs[k])
+// of weight ws[k], by Gusfield's algorithm: every tree edge (s, parent[s])
+// is a minimum s-t cut, and the smallest cut between any pair lies on
+// the tree path between them. Returns the tree cuts below threshold
+// with the side of each.
+void Separator::_gomoryHu(size_t m, const vector<size_t>& us, const vector<size_t>& vs, const vector<double>& ws, double threshold, vector<double>& values, vector<vector<char> >& sides) {
+    values.clear();
+    sides.clear();
+    if (m < 2)
+        return;
+    
+    MaxFlow flow(m);
+    for (size_t k = 0; k < us.size(); k++)
+        flow.addEdge(us[k], vs[k], ws[k]);
+    
+    vector<size_t> parent(m, 0);
+    vector<char>   side;
+    for (size_t s = 1; s < m; s++) {
+        size_t t     = parent[s];
+        double value = flow.solve(s, t, side);
+        
+        if (value < threshold) {
+            values.push_back(value);
+            sides.push_back(side);
+        }//if
+        
+        for (size_t i = s + 1; i < m; i++)
+            if (side[i] && parent[i] == t)
+                parent[i] = s;
+    }//for
+}
+
+static bool compareCuts(const Cut& a, const Cut& b) {
+    return a.violation() > b.violation();
+}
+
+// The most violated cuts of found, each once, at most maxCuts of them
+// (all if maxCuts is 0)
+void Separator::_keepBest(vector<Cut>& found, size_t maxCuts, vector<Cut>& cuts) {
+    sort(found.begin(), found.end(), compareCuts);
+    set<pair<vector<Identifier>, vector<vector<Identifier> > > > seen;
+    for (Cut& cut : found) {
+        if (maxCuts > 0 && cuts.size() >= maxCuts) break;
+        if (!seen.insert(make_pair(cut.nodes, cut.teeth)).second) continue;
+        cuts.push_back(cut);
+    }//for
+}
+
+// Ids and coefficients of the row of a cut: every edge counts once for
+// each of the handle and teeth it crosses
+void Separator::cutRow(const Cut& cut, vector<size_t>& ids, vector<double>& coefs) {
+    const Adjacency& adjacency = _graph->adjacency();
+    _coefs.resize(_graph->edgesCount(), 0.0);
+    ids.clear();
+    coefs.clear();
+    
+    for (size_t k = 0; k <= cut.teeth.size(); k++) {
+        const vector<Identifier>& nodes = (k == 0) ? cut.nodes : cut.teeth[k - 1];
+        for (Identifier v : nodes)
+            _inSet[v] = 1;
+        
+        for (Identifier v : nodes) {
+            ArrayView<Identifier> neighbors = adjacency.neighbors(v);
+            ArrayView<Identifier> edgeIds   = adjacency.edgeIds(v);
+            for (size_t j = 0; j < neighbors.size(); j++) {
+                if (_inSet[neighbors[j]]) continue;
+                if (_coefs[edgeIds[j]] == 0)
+                    ids.push_back(edgeIds[j]);
+                _coefs[edgeIds[j]] += 1.0;
+            }//for
+        }//for
+        
+        for (Identifier v : nodes)
+            _inSet[v] = 0;
+    }//for
+    
+    for (size_t id : ids) {
+        coefs.push_back(_coefs[id]);
+        _coefs[id] = 0;
+    }//for
+}
+
+// Left side of a cut in the solution the support graph was built from;
+// edges outside the support carry nothing
+double Separator::_supportValue(const Cut& cut) {
+    double re = 0;
+    for (size_t k = 0; k <= cut.teeth.size(); k++) {
+        const vector<Identifier>& nodes = (k == 0) ? cut.nodes : cut.teeth[k - 1];
+        for (Identifier v : nodes)
+            _inSet[v] = 1;
+        
+        for (Identifier v : nodes)
+            for (const SupportEdge& e : _support[v])
+                if (!_inSet[e.to]) re += e.x;
+        
+        for (Identifier v : nodes)
+            _inSet[v] = 0;
+    }//for
+    return re;
+}
+
+SubtourSeparator::SubtourSeparator(Graph& graph) : Separator(graph) {
+}
+
+// Records the cut of the union of the given shrunk nodes, as the side
+// without node 0 so that the same cut found twice looks the same
+void SubtourSeparator::_addCut(DisjointSets& shrunk, const vector<Identifier>& roots, double value, vector<Cut>& cuts) {
+    Cut cut;
+    cut.value = value;
+    for (Identifier r : roots) {
+        vector<Identifier> members = shrunk.set(r);
+        cut.nodes.insert(cut.nodes.end(), members.begin(), members.end());
+    }//for
+    if (cut.nodes.empty() || cut.nodes.size() == _ncount)
+        return;
+    
+    sort(cut.nodes.begin(), cut.nodes.end());
+    if (cut.nodes[0] == 0) {
+        vector<Identifier> other;
+        other.reserve(_ncount - cut.nodes.size());
+        size_t k = 0;
+        for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+            if (k < cut.nodes.size() && cut.nodes[k] == v)
+                k++;
+            else
+                other.push_back(v);
+        }//for
+        cut.nodes.swap(other);
+    }//if
+    cuts.push_back(cut);
+}
+
+void SubtourSeparator::_shrink(DisjointSets& shrunk, vector<Cut>& cuts) {
+    vector<Identifier> work;
+    for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+        work.push_back(v);
+        if (_degree[v] < 2 - CUT_EPSILON)
+            _addCut(shrunk, vector<Identifier>(1, v), _degree[v], cuts);
+    }//for
+    
+    while (!work.empty() && shrunk.count() > 2) {
+        Identifier u = work.back();
+        work.pop_back();
+        if (shrunk.find(u) != u) continue;
+        
+        for (map<Identifier, double>::iterator it = _adj[u].begin(); it != _adj[u].end(); it++) {
+            Identifier v = it->first;
+            double     w = it->second;
+            if (w < min(_degree[u], _degree[v]) / 2 - CUT_EPSILON) continue;
+            
+            shrunk.merge(u, v);
+            Identifier root  = shrunk.find(u);
+            Identifier other = (root == u) ? v : u;
+            
+            // Move the edges of the absorbed node to the root
+            for (map<Identifier, double>::iterator jt = _adj[other].begin(); jt != _adj[other].end(); jt++) {
+                if (jt->first == root) continue;
+                _adj[root][jt->first] += jt->second;
+                _adj[jt->first].erase(other);
+                _adj[jt->first][root] += jt->second;
+            }//for
+            _adj[root].erase(other);
+            _adj[other].clear();
+            _degree[root] = _degree[u] + _degree[v] - 2 * w;
+            
+            if (_degree[root] < 2 - CUT_EPSILON)
+                _addCut(shrunk, vector<Identifier>(1, root), _degree[root], cuts);
+            work.push_back(root);
+            break;
+        }//for
+    }//while
+}
+
+// Violated subtour constraints, the most violated first and at most
+// maxCuts of them (all if maxCuts is 0)
+void SubtourSeparator::separate(const vector<double>& vals, size_t maxCuts, vector<Cut>& cuts) {
+    vector<Cut> found;
+    DisjointSets shrunk(_ncount);
+    
+    _buildSupport(vals);
+    _adj.assign(_ncount, map<Identifier, double>());
+    _degree.assign(_ncount, 0);
+    for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+        for (const SupportEdge& e : _support[v]) {
+            _adj[v][e.to] += e.x;
+            _degree[v]    += e.x;
+        }//for
+    }//for
+    _shrink(shrunk, found);
+    
+    vector<Identifier> roots;
+    vector<size_t>     index(_ncount, 0);
+    for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+        if (shrunk.find(v) != v) continue;
+        index[v] = roots.size();
+        roots.push_back(v);
+    }//for
+    
+    vector<size_t> us, vs;
+    vector<double> ws;
+    for (size_t a = 0; a < roots.size(); a++) {
+        for (map<Identifier, double>::iterator it = _adj[roots[a]].begin(); it != _adj[roots[a]].end(); it++) {
+            if (index[it->first] <= a) continue;
+            us.push_back(a);
+            vs.push_back(index[it->first]);
+            ws.push_back(it->second);
+        }//for
+    }//for
+    
+    vector<double>         values;
+    vector<vector<char> >  sides;
+    _gomoryHu(roots.size(), us, vs, ws, 2 - CUT_EPSILON, values, sides);
+    for (size_t k = 0; k < values.size(); k++) {
+        vector<Identifier> sideRoots;
+        for (size_t a = 0; a < roots.size(); a++)
+            if (sides[k][a]) sideRoots.push_back(roots[a]);
+        _addCut(shrunk, sideRoots, values[k], found);
+    }//for
+    
+    _keepBest(found, maxCuts, cuts);
+}
+
+CombSeparator::CombSeparator(Graph& graph) : Separator(graph) {
+}
+
+void CombSeparator::_blossoms(const vector<double>& vals, vector<Cut>& found) {
+    ArrayView<Edge> edges = _graph->edges();
+    vector<size_t> us, vs;
+    vector<double> ws;
+    for (size_t i = 0; i < vals.size(); i++) {
+        if (vals[i] <= SUPPORT_EPSILON) continue;
+        us.push_back(edges[i].source());
+        vs.push_back(edges[i].destination());
+        ws.push_back(min(vals[i], 1 - vals[i]));
+    }//for
+    
+    // The parity fix costs at least as much as the tree cut, so cuts of 1
+    // or more cannot give a violated blossom
+    vector<double>         values;
+    vector<vector<char> >  sides;
+    _gomoryHu(_ncount, us, vs, ws, 1 - CUT_EPSILON, values, sides);
+    
+    for (size_t k = 0; k < sides.size(); k++) {
+        const vector<char>& inH = sides[k];
+        
+        // Cost of the handle: x_e for crossing edges and 1 - x_e for teeth
+        double cost      = 0;
+        double bestSwap  = COST_INFINITY;
+        size_t swapEdge  = 0;
+        vector<size_t> teeth;
+        for (Identifier v = 0; v < (Identifier) _ncount; v++) {
+            if (!inH[v]) continue;
+            for (const SupportEdge& e : _support[v]) {
+                if (inH[e.to]) continue;
+                cost += min(e.x, 1 - e.x);
+                if (e.x > 0.5)
+                    teeth.push_back(e.id);
+                if (fabs(1 - 2 * e.x) < bestSwap) {
+                    bestSwap = fabs(1 - 2 * e.x);
+                    swapEdge = e.id;
+                }//if
+            }//for
+        }//for
+        
+        if (teeth.size() % 2 == 0) {
+            if (bestSwap >= COST_INFINITY) continue;
+            cost += bestSwap;
+            vector<size_t>::iterator it = find(teeth.begin(), teeth.end(), swapEdge);
+            if (it != teeth.end())
+                teeth.erase(it);
+            else
+                teeth.push_back(swapEdge);
+        }//if
+        if (teeth.size() < 3 || cost >= 1 - CUT_EPSILON) continue;
+        
+        Cut cut;
+        for (Identifier v = 0; v < (Identifier) _ncount; v++)
+            if (inH[v]) cut.nodes.push_back(v);
+        for (size_t id : teeth) {
+            vector<Identifier> tooth;
+            tooth.push_back(min(edges[id].source(), edges[id].destination()));
+            tooth.push_back(max(edges[id].source(), edges[id].destination()));
+            cut.teeth.push_back(tooth);
+        }//for
+        sort(cut.teeth.begin(), cut.teeth.end());
+        cut.value = _supportValue(cut);
+        if (cut.violation() > CUT_EPSILON)
+            found.push_back(cut);
+    }//for
+}
+
+void CombSeparator::_combs(vector<Cut>& found) {
+    DisjointSets fractional(_ncount);
+    for (Identifier v = 0; v < (Identifier) _ncount; v++)
+        for (const SupportEdge& e : _support[v])
+            if (e.x < 1 - CUT_EPSILON)
+                fractional.merge(v, e.to);
+    
+    vector<char> used(_ncount, 0);
+    for (Identifier r = 0; r < (Identifier) _ncount; r++) {
+        if (fractional.find(r) != r || fractional.setSize(r) < 3) continue;
+        
+        Cut cut;
+        cut.nodes = fractional.set(r);
+        sort(cut.nodes.begin(), cut.nodes.end());
+        for (Identifier v : cut.nodes)
+            _inSet[v] = 1;
+        
+        // Each tooth starts with an edge at 1 leaving the handle and
+        // follows the path of such edges while it stays outside
+        for (Identifier v : cut.nodes) {
+            if (used[v]) continue;
+            for (const SupportEdge& e : _support[v]) {
+                if (e.x < 1 - CUT_EPSILON || _inSet[e.to] || used[e.to]) continue;
+                
+                vector<Identifier> tooth;
+                tooth.push_back(v);
+                tooth.push_back(e.to);
+                used[v]    = 1;
+                used[e.to] = 1;
+                Identifier prev = v, cur = e.to;
+                bool extended = true;
+                while (extended) {
+                    extended = false;
+                    for (const SupportEdge& f : _support[cur]) {
+                        if (f.x < 1 - CUT_EPSILON || f.to == prev || _inSet[f.to] || used[f.to]) continue;
+                        tooth.push_back(f.to);
+                        used[f.to] = 1;
+                        prev = cur;
+                        cur  = f.to;
+                        extended = true;
+                        break;
+                    }//for
+                }//while
+                
+                sort(tooth.begin(), tooth.end());
+                cut.teeth.push_back(tooth);
+                break;
+            }//for
+        }//for
+        
+        for (Identifier v : cut.nodes)
+            _inSet[v] = 0;
+        
+        if (cut.teeth.size() % 2 == 0 && !cut.teeth.empty())
+            cut.teeth.pop_back();
+        if (cut.teeth.size() < 3) continue;
+        
+        sort(cut.teeth.begin(), cut.teeth.end());
+        cut.value = _supportValue(cut);
+        if (cut.violation() > CUT_EPSILON)
+            found.push_back(cut);
+    }//for
+}
+
+// Violated blossoms and combs, the most violated first and at most
+// maxCuts of them (all if maxCuts is 0)
+void CombSeparator::separate(const vector<double>& vals, size_t maxCuts, vector<Cut>& cuts) {
+    vector<Cut> found;
+    
+    _buildSupport(vals);
+    _blossoms(vals, found);
+    _combs(found);
+    _keepBest(found, maxCuts, cuts);
+}
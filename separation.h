@@ -0,0 +1,100 @@
+//
+//  separation.h
+//  TSP
+//
+//  Separation of inequalities violated by fractional LP solutions.
+//
+
+#ifndef __TSP__separation__
+#define __TSP__separation__
+
+#include <vector>
+#include <map>
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define SUPPORT_EPSILON     0.00000001
+#define CUT_EPSILON         0.000001
+
+// An inequality in cut form on a handle H and teeth T_1..T_t:
+//   x(δ(H)) + x(δ(T_1)) + ... + x(δ(T_t)) >= rhs
+// Without teeth it is the subtour constraint x(δ(H)) >= 2; with an odd
+// number t >= 3 of teeth it is a comb, rhs 3t + 1 (a blossom when every
+// tooth is a single edge). value is the left side in the separated
+// solution.
+struct Cut {
+    vector<Identifier>          nodes;
+    vector<vector<Identifier> > teeth;
+    double                      value;
+    
+    double rhs      () const { return teeth.empty() ? 2.0 : 3.0 * teeth.size() + 1; }
+    double violation() const { return rhs() - value; }
+};
+
+// Common part of the separators: the support graph of a solution and the
+// translation of cuts into LP rows
+class Separator {
+protected:
+    struct SupportEdge {
+        Identifier to;
+        size_t     id;
+        double     x;
+    };
+    
+    Graph*                         _graph;
+    size_t                         _ncount;
+    vector<vector<SupportEdge> >   _support;
+    vector<char>                   _inSet;
+    vector<double>                 _coefs;
+    
+    void   _buildSupport(const vector<double>&);
+    void   _gomoryHu    (size_t, const vector<size_t>&, const vector<size_t>&, const vector<double>&, double, vector<double>&, vector<vector<char> >&);
+    void   _keepBest    (vector<Cut>&, size_t, vector<Cut>&);
+    double _supportValue(const Cut&);
+    
+public:
+    Separator(Graph&);
+    
+    void cutRow(const Cut&, vector<size_t>&, vector<double>&);
+};
+
+// Exact separation of subtour constraints. The support graph of the
+// solution is shrunk with the Padberg-Rinaldi rule: nodes u, v joined
+// by weight w(u, v) >= min(d(u), d(v)) / 2 are never separated by a
+// cut that is smaller than all cuts not separating them, so they are
+// merged. A Gomory-Hu tree of the shrunk graph (Gusfield's algorithm)
+// then gives a minimum cut for every pair of the remaining nodes.
+class SubtourSeparator : public Separator {
+private:
+    vector<map<Identifier, double> > _adj;
+    vector<double>                   _degree;
+    
+    void _shrink  (DisjointSets&, vector<Cut>&);
+    void _addCut  (DisjointSets&, const vector<Identifier>&, double, vector<Cut>&);
+    
+public:
+    SubtourSeparator(Graph&);
+    
+    void separate(const vector<double>&, size_t, vector<Cut>&);
+};
+
+// Blossoms and combs. Blossoms are separated exactly as odd cuts
+// (Letchford, Reinelt and Theis): with edge weights min(x_e, 1 - x_e),
+// the best handle is among the cuts of a Gomory-Hu tree, its teeth the
+// crossing edges with x_e > 1/2, parity fixed by the cheapest swap.
+// Combs come from a heuristic: handles are the components of the
+// fractional edges, teeth follow paths of edges at 1 out of the handle.
+class CombSeparator : public Separator {
+private:
+    void _blossoms(const vector<double>&, vector<Cut>&);
+    void _combs   (vector<Cut>&);
+    
+public:
+    CombSeparator(Graph&);
+    
+    void separate(const vector<double>&, size_t, vector<Cut>&);
+};
+
+#endif /* defined(__TSP__separation__) */
@@ -0,0 +1,895 @@
+//
+//  simplex.cpp
+//  TSP
+//
+//  Bounded-variable dual simplex used as the built-in LP backend.
+//
+
+#include "simplex.h"
+#include <math.h>
+#include <algorithm>
+
+#define PRIMAL_TOLERANCE   0.0000001
+#define DUAL_TOLERANCE     0.000000001
+#define PIVOT_TOLERANCE    0.000000001
+#define DROP_TOLERANCE     0.000000000001
+#define REFACTOR_INTERVAL  100
+#define ITERATIONS_PER_VAR 100
+#define PIVOT_THRESHOLD    0.01
+#define PIVOT_CANDIDATES   4
+#define NO_INDEX           ((size_t) -1)
+
+BasisFactor::BasisFactor() {
+    _size        = 0;
+    _luNonzeros  = 0;
+    _etaNonzeros = 0;
+}
+
+// Factors the m x m matrix given by its columns, the basis positions.
+// Each step picks, among the active columns with fewest entries, an entry
+// within PIVOT_THRESHOLD of the largest of its column that minimizes the
+// Markowitz count (row entries - 1)(column entries - 1), eliminates its
+// column below it and keeps its row as a row of U. Singletons, like the
+// columns of basic slacks, cost nothing. False when the matrix is singular.
+bool BasisFactor::factor(size_t m, const vector<SparseVector>& columns) {
+    _size = m;
+    _pivotRow.clear();
+    _pivotCol.clear();
+    _pivotValue.clear();
+    _lower.assign(m, SparseVector());
+    _upper.assign(m, SparseVector());
+    _etas.clear();
+    _luNonzeros  = 0;
+    _etaNonzeros = 0;
+    
+    // The active submatrix by columns, and the pattern of its rows, which
+    // may still list columns eliminated since
+    vector<SparseVector>   cols(columns);
+    vector<vector<size_t> > rowCols(m);
+    vector<size_t>         rowCount(m, 0);
+    for (size_t j = 0; j < m; j++)
+        for (size_t k = 0; k < cols[j].size(); k++) {
+            rowCols[cols[j][k].first].push_back(j);
+            rowCount[cols[j][k].first]++;
+        }//for
+    
+    vector<bool>   colDone(m, false);
+    vector<size_t> position(m, NO_INDEX);
+    vector<size_t> seen(m, NO_INDEX);
+    
+    for (size_t step = 0; step < m; step++) {
+        // The PIVOT_CANDIDATES shortest columns
+        vector<size_t> candidates;
+        for (size_t j = 0; j < m; j++) {
+            if (colDone[j]) continue;
+            if (candidates.size() < PIVOT_CANDIDATES)
+                candidates.push_back(j);
+            else if (cols[j].size() < cols[candidates.back()].size())
+                candidates.back() = j;
+            else
+                continue;
+            for (size_t c = candidates.size() - 1; c > 0 && cols[candidates[c]].size() < cols[candidates[c - 1]].size(); c--)
+                swap(candidates[c], candidates[c - 1]);
+        }//for
+        
+        size_t r = NO_INDEX, c = NO_INDEX, bestCost = NO_INDEX;
+        double bestValue = 0;
+        for (size_t k = 0; k < candidates.size(); k++) {
+            const SparseVector& col = cols[candidates[k]];
+            double largest = 0;
+            for (size_t e = 0; e < col.size(); e++)
+                largest = max(largest, fabs(col[e].second));
+            if (largest < PIVOT_TOLERANCE) continue;
+            
+            for (size_t e = 0; e < col.size(); e++) {
+                double value = fabs(col[e].second);
+                if (value < PIVOT_THRESHOLD * largest || value < PIVOT_TOLERANCE) continue;
+                size_t cost = (rowCount[col[e].first] - 1) * (col.size() - 1);
+                if (cost < bestCost || (cost == bestCost && value > bestValue)) {
+                    r         = col[e].first;
+                    c         = candidates[k];
+                    bestCost  = cost;
+                    bestValue = value;
+                }//if
+            }//for
+        }//for
+        if (c == NO_INDEX)
+            return false;
+        
+        // Column c below the pivot goes to L, row r to U
+        SparseVector& pivotCol = cols[c];
+        double pivot = 0;
+        for (size_t e = 0; e < pivotCol.size(); e++)
+            if (pivotCol[e].first == r)
+                pivot = pivotCol[e].second;
+        
+        SparseVector& lower = _lower[step];
+        for (size_t e = 0; e < pivotCol.size(); e++) {
+            rowCount[pivotCol[e].first]--;
+            if (pivotCol[e].first != r)
+                lower.push_back(make_pair(pivotCol[e].first, pivotCol[e].second / pivot));
+        }//for
+        pivotCol.clear();
+        colDone[c] = true;
+        
+        SparseVector& upper = _upper[step];
+        for (size_t e = 0; e < rowCols[r].size(); e++) {
+            size_t j = rowCols[r][e];
+            if (colDone[j] || seen[j] == step) continue;
+            seen[j] = step;
+            
+            SparseVector& col = cols[j];
+            for (size_t k = 0; k < col.size(); k++) {
+                if (col[k].first != r) continue;
+                if (col[k].second != 0)
+                    upper.push_back(make_pair(j, col[k].second));
+                col[k] = col.back();
+                col.pop_back();
+                break;
+            }//for
+        }//for
+        
+        // Schur complement: a_ij -= l_i u_j, with fill-in where a_ij was zero
+        for (size_t e = 0; e < upper.size(); e++) {
+            SparseVector& col = cols[upper[e].first];
+            double        u   = upper[e].second;
+            for (size_t k = 0; k < col.size(); k++)
+                position[col[k].first] = k;
+            for (size_t k = 0; k < lower.size(); k++) {
+                size_t i = lower[k].first;
+                if (position[i] != NO_INDEX)
+                    col[position[i]].second -= lower[k].second * u;
+                else {
+                    position[i] = col.size();
+                    col.push_back(make_pair(i, -lower[k].second * u));
+                    rowCols[i].push_back(upper[e].first);
+                    rowCount[i]++;
+                }//else
+            }//for
+            for (size_t k = 0; k < col.size(); k++)
+                position[col[k].first] = NO_INDEX;
+        }//for
+        
+        _pivotRow.push_back(r);
+        _pivotCol.push_back(c);
+        _pivotValue.push_back(pivot);
+        _luNonzeros += 1 + lower.size() + upper.size();
+    }//for
+    return true;
+}
+
+// Solves B x = b in place: b by rows in, x by basis positions out
+void BasisFactor::ftran(vector<double>& v) const {
+    _work.assign(v.begin(), v.begin() + _size);
+    for (size_t k = 0; k < _size; k++) {
+        double b = _work[_pivotRow[k]];
+        if (b == 0) continue;
+        const SparseVector& lower = _lower[k];
+        for (size_t e = 0; e < lower.size(); e++)
+            _work[lower[e].first] -= lower[e].second * b;
+    }//for
+    for (size_t k = _size; k-- > 0; ) {
+        double x = _work[_pivotRow[k]];
+        const SparseVector& upper = _upper[k];
+        for (size_t e = 0; e < upper.size(); e++)
+            x -= upper[e].second * v[upper[e].first];
+        v[_pivotCol[k]] = x / _pivotValue[k];
+    }//for
+    
+    for (size_t k = 0; k < _etas.size(); k++) {
+        const Eta& eta = _etas[k];
+        double&    x   = v[eta.position];
+        if (eta.border) {
+            double s = -x;
+            for (size_t e = 0; e < eta.entries.size(); e++)
+                s += eta.entries[e].second * v[eta.entries[e].first];
+            x = s;
+        }//if
+        else if (x != 0) {
+            x /= eta.pivot;
+            for (size_t e = 0; e < eta.entries.size(); e++)
+                v[eta.entries[e].first] -= eta.entries[e].second * x;
+        }//else if
+    }//for
+}
+
+// Solves y'B = c' in place: c by basis positions in, y by rows out
+void BasisFactor::btran(vector<double>& v) const {
+    for (size_t k = _etas.size(); k-- > 0; ) {
+        const Eta& eta = _etas[k];
+        double&    y   = v[eta.position];
+        if (eta.border) {
+            if (y != 0)
+                for (size_t e = 0; e < eta.entries.size(); e++)
+                    v[eta.entries[e].first] += y * eta.entries[e].second;
+            y = -y;
+        }//if
+        else {
+            double s = y;
+            for (size_t e = 0; e < eta.entries.size(); e++)
+                s -= eta.entries[e].second * v[eta.entries[e].first];
+            y = s / eta.pivot;
+        }//else
+    }//for
+    
+    _work.assign(v.begin(), v.begin() + _size);
+    for (size_t k = 0; k < _size; k++) {
+        double z = _work[_pivotCol[k]] / _pivotValue[k];
+        v[_pivotRow[k]] = z;
+        if (z == 0) continue;
+        const SparseVector& upper = _upper[k];
+        for (size_t e = 0; e < upper.size(); e++)
+            _work[upper[e].first] -= z * upper[e].second;
+    }//for
+    for (size_t k = _size; k-- > 0; ) {
+        double z = v[_pivotRow[k]];
+        const SparseVector& lower = _lower[k];
+        for (size_t e = 0; e < lower.size(); e++)
+            z -= v[lower[e].first] * lower[e].second;
+        v[_pivotRow[k]] = z;
+    }//for
+}
+
+// The column at position r is replaced by a_q, with aq = B^-1 a_q
+void BasisFactor::replace(size_t r, const vector<double>& aq) {
+    Eta eta;
+    eta.border   = false;
+    eta.position = r;
+    eta.pivot    = aq[r];
+    for (size_t p = 0; p < aq.size(); p++)
+        if (p != r && fabs(aq[p]) > DROP_TOLERANCE)
+            eta.entries.push_back(make_pair(p, aq[p]));
+    _etaNonzeros += 1 + eta.entries.size();
+    _etas.push_back(eta);
+}
+
+// A new last row r' over the current basis positions, with its slack
+// basic at a new last position
+void BasisFactor::border(const SparseVector& row) {
+    Eta eta;
+    eta.border   = true;
+    eta.position = _size;
+    eta.pivot    = -1;
+    eta.entries  = row;
+    for (size_t k = 0; k < _etas.size(); k++)
+        if (_etas[k].border) eta.position++;
+    _etaNonzeros += 1 + row.size();
+    _etas.push_back(eta);
+}
+
+// Solves through the eta file take longer than through fresh factors
+bool BasisFactor::tooLong() const {
+    return _etaNonzeros > _luNonzeros + _size;
+}
+
+DualSimplex::DualSimplex() {
+    _factored       = true;
+    _dualsValid     = false;
+    _saved          = false;
+    _savedUpdates   = 0;
+    _updates        = 0;
+    _iterations     = 0;
+    _iterationLimit = 0;
+    _objValue       = 0;
+}
+
+DualSimplex::~DualSimplex() {
+}
+
+size_t DualSimplex::_varsCount() const {
+    return _cost.size() + _rows.size();
+}
+
+double DualSimplex::_lower(size_t j) const {
+    return (j < _cost.size()) ? _colLower[j] : _rowLower[j - _cost.size()];
+}
+
+double DualSimplex::_upper(size_t j) const {
+    return (j < _cost.size()) ? _colUpper[j] : _rowUpper[j - _cost.size()];
+}
+
+double DualSimplex::_varCost(size_t j) const {
+    return (j < _cost.size()) ? _cost[j] : 0.0;
+}
+
+double DualSimplex::_nonbasicValue(size_t j) const {
+    return (_status[j] == LP_AT_UPPER) ? _upper(j) : _lower(j);
+}
+
+// Clips the bounds of row i to the activity range that the widest column
+// bounds seen so far allow, so that its slack is boxed
+void DualSimplex::_clipRow(size_t i) {
+    double minActivity = 0, maxActivity = 0;
+    for (size_t k = 0; k < _rows[i].size(); k++) {
+        size_t col  = _rows[i][k].first;
+        double coef = _rows[i][k].second;
+        minActivity += min(coef * _colMin[col], coef * _colMax[col]);
+        maxActivity += max(coef * _colMin[col], coef * _colMax[col]);
+    }//for
+    
+    _rowLower[i] = max(_rowLowerGiven[i], minActivity);
+    _rowUpper[i] = min(_rowUpperGiven[i], maxActivity);
+    
+    // A row that cannot be satisfied keeps its bound; the solve then
+    // reports the problem infeasible
+    if (_rowLower[i] > _rowUpper[i])
+        _rowUpper[i] = _rowLower[i];
+}
+
+size_t DualSimplex::addColumn(double cost, double lb, double ub) {
+    if (lb <= -LP_INFINITY || ub >= LP_INFINITY)
+        throw "Columns of the dual simplex must have finite bounds!";
+    
+    size_t j = _cost.size();
+    _cost.push_back(cost);
+    _colLower.push_back(lb);
+    _colUpper.push_back(ub);
+    _colMin.push_back(lb);
+    _colMax.push_back(ub);
+    _columns.push_back(SparseVector());
+    
+    // Slack variables follow the columns, so they move up by one
+    for (size_t p = 0; p < _head.size(); p++)
+        if (_head[p] >= j) _head[p]++;
+    _status.insert(_status.begin() + j, (char) (cost >= 0 ? LP_AT_LOWER : LP_AT_UPPER));
+    _value.insert(_value.begin() + j, cost >= 0 ? lb : ub);
+    _reduced.insert(_reduced.begin() + j, cost);
+    _saved = false;
+    
+    return j;
+}
+
+size_t DualSimplex::addRow(const vector<size_t>& cols, const vector<double>& coefs, double lb, double ub) {
+    size_t i = _rows.size();
+    _saved   = false;
+    
+    _rows.push_back(SparseVector());
+    for (size_t k = 0; k < cols.size(); k++) {
+        if (coefs[k] == 0) continue;
+        _rows[i].push_back(make_pair(cols[k], coefs[k]));
+        _columns[cols[k]].push_back(make_pair(i, coefs[k]));
+    }//for
+    _rowLowerGiven.push_back(lb);
+    _rowUpperGiven.push_back(ub);
+    _rowLower.push_back(lb);
+    _rowUpper.push_back(ub);
+    _clipRow(i);
+    
+    // The new slack enters the basis in the new row. With B' = [B 0; r' -1]
+    // the inverse is [B^-1 0; r'B^-1 -1], so the factorization stays valid
+    // with r as a border.
+    size_t slack = _cost.size() + i;
+    _status.push_back(LP_BASIC);
+    _value.push_back(0);
+    _reduced.push_back(0);
+    _head.push_back(slack);
+    
+    if (_factored) {
+        vector<double> coefOfCol(_cost.size(), 0.0);
+        for (size_t k = 0; k < _rows[i].size(); k++)
+            coefOfCol[_rows[i][k].first] = _rows[i][k].second;
+        SparseVector r;
+        for (size_t p = 0; p < i; p++) {
+            size_t var = _head[p];
+            if (var < _cost.size() && coefOfCol[var] != 0)
+                r.push_back(make_pair(p, coefOfCol[var]));
+        }//for
+        _factor.border(r);
+    }//if
+    
+    return i;
+}
+
+void DualSimplex::removeRows(const vector<size_t>& rows) {
+    if (rows.empty())
+        return;
+    
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    vector<bool> removed(m, false);
+    for (size_t k = 0; k < rows.size(); k++)
+        removed[rows[k]] = true;
+    
+    // Every removed row must have its slack basic, so that dropping the
+    // row together with the basis position of the slack leaves a valid
+    // basis. A nonbasic slack is pivoted in where it has the largest
+    // entry; the variable it replaces goes to its nearest bound.
+    if (!_factored && !_refactor())
+        _slackBasis();
+    for (size_t i = 0; i < m; i++) {
+        size_t slack = n + i;
+        if (!removed[i] || _status[slack] == LP_BASIC) continue;
+        
+        if (!_factored && !_refactor()) {
+            _slackBasis();
+            break;
+        }//if
+        
+        _ftran(slack, _aq);
+        size_t best = NO_INDEX;
+        for (size_t p = 0; p < m; p++) {
+            if (_head[p] >= n && removed[_head[p] - n]) continue;
+            if (best == NO_INDEX || fabs(_aq[p]) > fabs(_aq[best]))
+                best = p;
+        }//for
+        if (best == NO_INDEX || fabs(_aq[best]) < PIVOT_TOLERANCE) {
+            _slackBasis();
+            break;
+        }//if
+        
+        size_t leaving = _head[best];
+        double mid     = (_lower(leaving) + _upper(leaving)) / 2;
+        _status[leaving] = (_value[leaving] > mid) ? LP_AT_UPPER : LP_AT_LOWER;
+        _status[slack]   = LP_BASIC;
+        _pivot(best, slack, _aq);
+    }//for
+    
+    // Renumber rows, drop their entries from the columns and their slacks
+    // from the variables
+    vector<size_t> newIndex(m, NO_INDEX);
+    size_t kept = 0;
+    for (size_t i = 0; i < m; i++)
+        if (!removed[i]) newIndex[i] = kept++;
+    
+    for (size_t j = 0; j < n; j++) {
+        SparseVector& col = _columns[j];
+        size_t w = 0;
+        for (size_t k = 0; k < col.size(); k++)
+            if (!removed[col[k].first])
+                col[w++] = make_pair(newIndex[col[k].first], col[k].second);
+        col.resize(w);
+    }//for
+    
+    vector<size_t> head;
+    for (size_t p = 0; p < _head.size(); p++) {
+        size_t var = _head[p];
+        if (var < n)
+            head.push_back(var);
+        else if (!removed[var - n])
+            head.push_back(n + newIndex[var - n]);
+    }//for
+    _head.swap(head);
+    
+    for (size_t i = 0, w = 0; i < m; i++) {
+        if (removed[i]) continue;
+        _rows[w]          = _rows[i];
+        _rowLower[w]      = _rowLower[i];
+        _rowUpper[w]      = _rowUpper[i];
+        _rowLowerGiven[w] = _rowLowerGiven[i];
+        _rowUpperGiven[w] = _rowUpperGiven[i];
+        _status[n + w]    = _status[n + i];
+        _value[n + w]     = _value[n + i];
+        _reduced[n + w]   = _reduced[n + i];
+        w++;
+    }//for
+    _rows.resize(kept);
+    _rowLower.resize(kept);
+    _rowUpper.resize(kept);
+    _rowLowerGiven.resize(kept);
+    _rowUpperGiven.resize(kept);
+    _status.resize(n + kept);
+    _value.resize(n + kept);
+    _reduced.resize(n + kept);
+    
+    if (_head.size() != kept)
+        _slackBasis();
+    _factored   = false;
+    _dualsValid = false;
+    _saved      = false;
+}
+
+void DualSimplex::setBounds(size_t j, double lb, double ub) {
+    if (lb <= -LP_INFINITY || ub >= LP_INFINITY)
+        throw "Columns of the dual simplex must have finite bounds!";
+    
+    _colLower[j] = lb;
+    _colUpper[j] = ub;
+    if (_status[j] != LP_BASIC)
+        _value[j] = _nonbasicValue(j);
+    
+    // Rows were clipped with the widest bounds seen; widening them further
+    // means clipping again
+    if (lb < _colMin[j] || ub > _colMax[j]) {
+        _colMin[j] = min(_colMin[j], lb);
+        _colMax[j] = max(_colMax[j], ub);
+        for (size_t k = 0; k < _columns[j].size(); k++)
+            _clipRow(_columns[j][k].first);
+    }//if
+}
+
+void DualSimplex::setRowBounds(size_t i, double lb, double ub) {
+    _rowLowerGiven[i] = lb;
+    _rowUpperGiven[i] = ub;
+    _clipRow(i);
+    
+    size_t slack = _cost.size() + i;
+    if (_status[slack] != LP_BASIC)
+        _value[slack] = _nonbasicValue(slack);
+}
+
+double DualSimplex::lowerBound(size_t j) {
+    return _colLower[j];
+}
+
+double DualSimplex::upperBound(size_t j) {
+    return _colUpper[j];
+}
+
+size_t DualSimplex::columnsCount() {
+    return _cost.size();
+}
+
+size_t DualSimplex::rowsCount() {
+    return _rows.size();
+}
+
+// aq = B^-1 a_j
+void DualSimplex::_ftran(size_t j, vector<double>& aq) const {
+    size_t m = _rows.size();
+    aq.assign(m, 0.0);
+    
+    if (j < _cost.size()) {
+        const SparseVector& col = _columns[j];
+        for (size_t k = 0; k < col.size(); k++)
+            aq[col[k].first] = col[k].second;
+    }//if
+    else
+        aq[j - _cost.size()] = -1.0;
+    _factor.ftran(aq);
+}
+
+// Replaces the basic variable at position r with q, aq = B^-1 a_q
+void DualSimplex::_pivot(size_t r, size_t q, const vector<double>& aq) {
+    _factor.replace(r, aq);
+    _head[r] = q;
+    _updates++;
+}
+
+// Factors the basis matrix from scratch: the basic columns of [A -I]
+// by basis position
+bool DualSimplex::_refactor() {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    
+    vector<SparseVector> basis(m);
+    for (size_t p = 0; p < m; p++) {
+        if (_head[p] < n)
+            basis[p] = _columns[_head[p]];
+        else
+            basis[p].push_back(make_pair(_head[p] - n, -1.0));
+    }//for
+    if (!_factor.factor(m, basis))
+        return false;
+    
+    _factored = true;
+    _updates  = 0;
+    return true;
+}
+
+void DualSimplex::_slackBasis() {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    
+    for (size_t j = 0; j < n; j++) {
+        _status[j] = (_cost[j] >= 0) ? LP_AT_LOWER : LP_AT_UPPER;
+        _value[j]  = _nonbasicValue(j);
+    }//for
+    _head.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        _status[n + i] = LP_BASIC;
+        _head[i]       = n + i;
+    }//for
+    
+    // The slack basis is -I, which factors trivially
+    _refactor();
+    _dualsValid = false;
+}
+
+// x_B = -B^-1 N x_N, as [A -I](x, s) = 0
+void DualSimplex::_computePrimal() {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    vector<double> activity(m, 0.0);
+    
+    for (size_t j = 0; j < n + m; j++) {
+        if (_status[j] == LP_BASIC) continue;
+        _value[j] = _nonbasicValue(j);
+        if (_value[j] == 0) continue;
+        
+        if (j < n) {
+            for (size_t k = 0; k < _columns[j].size(); k++)
+                activity[_columns[j][k].first] += _columns[j][k].second * _value[j];
+        }//if
+        else
+            activity[j - n] -= _value[j];
+    }//for
+    
+    _factor.ftran(activity);
+    for (size_t p = 0; p < m; p++)
+        _value[_head[p]] = -activity[p];
+}
+
+// y' = c_B' B^-1 and d_j = c_j - y'a_j
+void DualSimplex::_computeDuals() {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    vector<double> y(m);
+    
+    for (size_t p = 0; p < m; p++)
+        y[p] = _varCost(_head[p]);
+    _factor.btran(y);
+    
+    for (size_t j = 0; j < n; j++) {
+        double d = _cost[j];
+        for (size_t k = 0; k < _columns[j].size(); k++)
+            d -= y[_columns[j][k].first] * _columns[j][k].second;
+        _reduced[j] = (_status[j] == LP_BASIC) ? 0.0 : d;
+    }//for
+    for (size_t i = 0; i < m; i++)
+        _reduced[n + i] = (_status[n + i] == LP_BASIC) ? 0.0 : y[i];
+    _dualsValid = true;
+}
+
+// Moves nonbasic variables whose reduced cost has the wrong sign to their
+// other bound; possible because every variable is boxed
+bool DualSimplex::_restoreDualFeasibility() {
+    bool changed = false;
+    for (size_t j = 0; j < _varsCount(); j++) {
+        if (_status[j] == LP_BASIC || _lower(j) == _upper(j)) continue;
+        
+        if (_status[j] == LP_AT_LOWER && _reduced[j] < -DUAL_TOLERANCE) {
+            _status[j] = LP_AT_UPPER;
+            changed = true;
+        }//if
+        else if (_status[j] == LP_AT_UPPER && _reduced[j] > DUAL_TOLERANCE) {
+            _status[j] = LP_AT_LOWER;
+            changed = true;
+        }//else if
+    }//for
+    return changed;
+}
+
+// The basic variable with the largest bound violation; direction is +1
+// when it lies below its lower bound and -1 when above its upper bound
+size_t DualSimplex::_chooseLeaving(int& direction) const {
+    size_t best      = NO_INDEX;
+    double bestViol  = PRIMAL_TOLERANCE;
+    
+    for (size_t p = 0; p < _head.size(); p++) {
+        size_t var = _head[p];
+        double v   = _value[var];
+        if (_lower(var) - v > bestViol) {
+            bestViol  = _lower(var) - v;
+            best      = p;
+            direction = 1;
+        }//if
+        else if (v - _upper(var) > bestViol) {
+            bestViol  = v - _upper(var);
+            best      = p;
+            direction = -1;
+        }//else if
+    }//for
+    return best;
+}
+
+LPStatus DualSimplex::solve() {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    long   limit = ITERATIONS_PER_VAR * (long) (n + m) + 1000;
+    _iterations = 0;
+    
+    if (!_factored && !_refactor()) {
+        _slackBasis();
+    }//if
+    _computePrimal();
+    // Reduced costs carry over from the previous solve: new rows come with
+    // basic slacks and bound changes leave them as they are
+    if (!_dualsValid)
+        _computeDuals();
+    if (_restoreDualFeasibility())
+        _computePrimal();
+    
+    while (true) {
+        int    s = 0;
+        size_t r = _chooseLeaving(s);
+        if (r == NO_INDEX)
+            break;
+        if (_iterations >= limit) {
+            _dualsValid = false;
+            return LP_ABORTED;
+        }//if
+        if (_iterationLimit > 0 && _iterations >= _iterationLimit) {
+            // Every basis on the way is dual feasible
+            _objValue = 0;
+            for (size_t j = 0; j < n; j++)
+                _objValue += _cost[j] * _value[j];
+            return LP_ITERATION_LIMIT;
+        }//if
+        
+        // Row r of B^-1 [A -I]
+        _rho.assign(m, 0.0);
+        _rho[r] = 1.0;
+        _factor.btran(_rho);
+        const double* rho = &_rho[0];
+        _alpha.assign(n, 0.0);
+        for (size_t i = 0; i < m; i++) {
+            if (fabs(rho[i]) < DROP_TOLERANCE) continue;
+            const SparseVector& row = _rows[i];
+            for (size_t k = 0; k < row.size(); k++)
+                _alpha[row[k].first] += rho[i] * row[k].second;
+        }//for
+        
+        // Harris ratio test: bound the step with slightly relaxed reduced
+        // costs, then pick the largest pivot among the candidates within it
+        double thetaMax = LP_INFINITY;
+        for (size_t j = 0; j < n + m; j++) {
+            if (_status[j] == LP_BASIC || _lower(j) == _upper(j)) continue;
+            double a = s * ((j < n) ? _alpha[j] : -rho[j - n]);
+            if (_status[j] == LP_AT_LOWER && a < -PIVOT_TOLERANCE)
+                thetaMax = min(thetaMax, (_reduced[j] + DUAL_TOLERANCE) / -a);
+            else if (_status[j] == LP_AT_UPPER && a > PIVOT_TOLERANCE)
+                thetaMax = min(thetaMax, (-_reduced[j] + DUAL_TOLERANCE) / a);
+        }//for
+        if (thetaMax >= LP_INFINITY)
+            return LP_INFEASIBLE;
+        
+        size_t q      = NO_INDEX;
+        double qAlpha = 0;
+        double qRatio = 0;
+        for (size_t j = 0; j < n + m; j++) {
+            if (_status[j] == LP_BASIC || _lower(j) == _upper(j)) continue;
+            double a = s * ((j < n) ? _alpha[j] : -rho[j - n]);
+            double ratio;
+            if (_status[j] == LP_AT_LOWER && a < -PIVOT_TOLERANCE)
+                ratio = _reduced[j] / -a;
+            else if (_status[j] == LP_AT_UPPER && a > PIVOT_TOLERANCE)
+                ratio = -_reduced[j] / a;
+            else
+                continue;
+            if (ratio <= thetaMax && fabs(a) > fabs(qAlpha)) {
+                q      = j;
+                qAlpha = a;
+                qRatio = ratio;
+            }//if
+        }//for
+        
+        _ftran(q, _aq);
+        double alphaRQ = _aq[r];
+        if (fabs(alphaRQ) < PIVOT_TOLERANCE || fabs(alphaRQ - s * qAlpha) > 0.000001 * (1 + fabs(alphaRQ))) {
+            // The updated inverse drifted; start over from a fresh one
+            if (_updates == 0) {
+                _dualsValid = false;
+                return LP_ABORTED;
+            }//if
+            if (!_refactor())
+                _slackBasis();
+            _computePrimal();
+            _computeDuals();
+            if (_restoreDualFeasibility())
+                _computePrimal();
+            continue;
+        }//if
+        
+        // Dual update
+        double t = max(qRatio, 0.0);
+        for (size_t j = 0; j < n + m; j++) {
+            if (_status[j] == LP_BASIC) continue;
+            double a = (j < n) ? _alpha[j] : -rho[j - n];
+            _reduced[j] += s * t * a;
+        }//for
+        size_t leaving = _head[r];
+        _reduced[q]       = 0;
+        _reduced[leaving] = s * t;
+        
+        // Primal update: the leaving variable moves onto its violated bound
+        double bound = (s > 0) ? _lower(leaving) : _upper(leaving);
+        double delta = (_value[leaving] - bound) / alphaRQ;
+        for (size_t p = 0; p < m; p++)
+            _value[_head[p]] -= _aq[p] * delta;
+        _value[q]        += delta;
+        _value[leaving]   = bound;
+        _status[leaving]  = (s > 0 || _lower(leaving) == _upper(leaving)) ? LP_AT_LOWER : LP_AT_UPPER;
+        _status[q]        = LP_BASIC;
+        
+        _pivot(r, q, _aq);
+        _iterations++;
+        
+        if (_updates >= REFACTOR_INTERVAL || _factor.tooLong()) {
+            if (!_refactor())
+                _slackBasis();
+            _computePrimal();
+            _computeDuals();
+            if (_restoreDualFeasibility())
+                _computePrimal();
+        }//if
+    }//while
+    
+    _objValue = 0;
+    for (size_t j = 0; j < n; j++)
+        _objValue += _cost[j] * _value[j];
+    return LP_OPTIMAL;
+}
+
+double DualSimplex::objValue() {
+    return _objValue;
+}
+
+void DualSimplex::primalValues(vector<double>& vals) {
+    vals.assign(_value.begin(), _value.begin() + _cost.size());
+}
+
+void DualSimplex::dualValues(vector<double>& duals) {
+    size_t m = _rows.size();
+    duals.resize(m);
+    for (size_t p = 0; p < m; p++)
+        duals[p] = _varCost(_head[p]);
+    _factor.btran(duals);
+}
+
+void DualSimplex::reducedCosts(vector<double>& costs) {
+    costs.assign(_reduced.begin(), _reduced.begin() + _cost.size());
+}
+
+void DualSimplex::getBasis(LPBasis& basis) {
+    size_t n = _cost.size();
+    basis.columns.assign(_status.begin(), _status.begin() + n);
+    basis.rows.assign(_status.begin() + n, _status.end());
+    
+    _saved = _factored;
+    if (_saved) {
+        _savedStatus  = _status;
+        _savedHead    = _head;
+        _savedFactor  = _factor;
+        _savedReduced = _reduced;
+        _savedUpdates = _updates;
+    }//if
+}
+
+void DualSimplex::setBasis(const LPBasis& basis) {
+    size_t n = _cost.size();
+    size_t m = _rows.size();
+    if (basis.columns.size() != n || basis.rows.size() > m)
+        return;
+    
+    // Back to the basis of the last getBasis(), e.g. after a trial solve
+    if (_saved && basis.rows.size() == m &&
+        equal(basis.columns.begin(), basis.columns.end(), _savedStatus.begin()) &&
+        equal(basis.rows.begin(), basis.rows.end(), _savedStatus.begin() + n)) {
+        _status     = _savedStatus;
+        _head       = _savedHead;
+        _factor     = _savedFactor;
+        _reduced    = _savedReduced;
+        _updates    = _savedUpdates;
+        _factored   = true;
+        _dualsValid = true;
+        return;
+    }//if
+    
+    // Rows added after the basis was taken keep their slacks basic
+    vector<size_t> head;
+    for (size_t j = 0; j < n + m; j++) {
+        char status = (j < n) ? basis.columns[j] : (j - n < basis.rows.size()) ? basis.rows[j - n] : (char) LP_BASIC;
+        if (status == LP_BASIC)
+            head.push_back(j);
+    }//for
+    if (head.size() != m)
+        return;
+    
+    copy(basis.columns.begin(), basis.columns.end(), _status.begin());
+    copy(basis.rows.begin(), basis.rows.end(), _status.begin() + n);
+    fill(_status.begin() + n + basis.rows.size(), _status.end(), (char) LP_BASIC);
+    _head.swap(head);
+    
+    // Factored by the next solve
+    _factored   = false;
+    _dualsValid = false;
+}
+
+long DualSimplex::iterations() {
+    return _iterations;
+}
+
+// Zero for no limit
+void DualSimplex::setIterationLimit(long limit) {
+    _iterationLimit = limit;
+}
@@ -0,0 +1,157 @@
+//
+//  simplex.h
+//  TSP
+//
+//  Bounded-variable dual simplex used as the built-in LP backend.
+//
+
+#ifndef __TSP__simplex__
+#define __TSP__simplex__
+
+#include <vector>
+#include <utility>
+#include "lp.h"
+using namespace std;
+
+// LU factors of a basis matrix, by sparse Gaussian elimination with
+// Markowitz pivoting, followed by a file of the changes made since: the
+// column replacements of simplex pivots, in product form, and rows
+// appended with their slack basic, as borders [B 0; r' -1]. ftran()
+// turns a vector indexed by rows into one indexed by basis positions,
+// solving B x = b; btran() solves y'B = c' the other way round.
+class BasisFactor {
+private:
+    typedef vector<pair<size_t, double> > SparseVector;
+    
+    // A pivot at position, with the other entries of the entering column
+    // B^-1 a_q, or a border row over the basis positions
+    struct Eta {
+        bool         border;
+        size_t       position;
+        double       pivot;
+        SparseVector entries;
+    };
+    
+    size_t               _size;
+    vector<size_t>       _pivotRow;
+    vector<size_t>       _pivotCol;
+    vector<double>       _pivotValue;
+    vector<SparseVector> _lower;
+    vector<SparseVector> _upper;
+    vector<Eta>          _etas;
+    size_t               _luNonzeros;
+    size_t               _etaNonzeros;
+    
+    // Scratch space of the solves
+    mutable vector<double> _work;
+    
+public:
+    BasisFactor();
+    
+    bool   factor (size_t, const vector<SparseVector>&);
+    void   ftran  (vector<double>&) const;
+    void   btran  (vector<double>&) const;
+    void   replace(size_t, const vector<double>&);
+    void   border (const SparseVector&);
+    bool   tooLong() const;
+};
+
+// Every row i gets a slack s_i = a_i'x bounded by the row bounds, so the
+// problem becomes [A -I](x, s) = 0 with all variables boxed. Row bounds
+// are clipped to the activity range implied by the column bounds, which
+// keeps every variable finite and lets dual feasibility always be
+// restored by moving nonbasic variables to their other bound. This fits
+// the TSP relaxation: 0/1 edge columns, degree-2 rows and cut rows that
+// are appended between solves while the current basis stays valid.
+//
+// The basis is kept as a BasisFactor: the degree rows and the edge
+// columns with two entries in them make the basis matrix very sparse,
+// and its LU factors stay sparse too. Pivots and new cut rows extend the
+// eta file; the basis is factored again when the file grows longer than
+// the factors or after REFACTOR_INTERVAL pivots.
+class DualSimplex : public LPSolver {
+private:
+    typedef vector<pair<size_t, double> > SparseVector;
+    
+    // Problem
+    vector<double>       _cost;
+    vector<double>       _colLower;
+    vector<double>       _colUpper;
+    vector<SparseVector> _columns;
+    vector<SparseVector> _rows;
+    vector<double>       _rowLower;
+    vector<double>       _rowUpper;
+    vector<double>       _rowLowerGiven;
+    vector<double>       _rowUpperGiven;
+    vector<double>       _colMin;
+    vector<double>       _colMax;
+    
+    // Basis and solution; variable j < columnsCount() is column j, the
+    // others are the slacks of the rows
+    vector<char>         _status;
+    vector<double>       _value;
+    vector<double>       _reduced;
+    vector<size_t>       _head;
+    BasisFactor          _factor;
+    bool                 _factored;
+    bool                 _dualsValid;
+    size_t               _updates;
+    long                 _iterations;
+    long                 _iterationLimit;
+    double               _objValue;
+    
+    // Factorization at the last getBasis(), restored when that basis is
+    // set again before the rows change
+    bool                 _saved;
+    vector<char>         _savedStatus;
+    vector<size_t>       _savedHead;
+    BasisFactor          _savedFactor;
+    vector<double>       _savedReduced;
+    size_t               _savedUpdates;
+    
+    // Scratch space of the iterations
+    vector<double>       _alpha;
+    vector<double>       _aq;
+    vector<double>       _rho;
+    
+    size_t _varsCount             () const;
+    double _lower                 (size_t) const;
+    double _upper                 (size_t) const;
+    double _varCost               (size_t) const;
+    double _nonbasicValue         (size_t) const;
+    void   _clipRow               (size_t);
+    void   _ftran                 (size_t, vector<double>&) const;
+    void   _pivot                 (size_t, size_t, const vector<double>&);
+    bool   _refactor              ();
+    void   _slackBasis            ();
+    void   _computePrimal         ();
+    void   _computeDuals          ();
+    bool   _restoreDualFeasibility();
+    size_t _chooseLeaving         (int&) const;
+    
+public:
+    DualSimplex ();
+    ~DualSimplex();
+    
+    size_t   addColumn   (double, double, double);
+    size_t   addRow      (const vector<size_t>&, const vector<double>&, double, double);
+    void     removeRows  (const vector<size_t>&);
+    void     setBounds   (size_t, double, double);
+    void     setRowBounds(size_t, double, double);
+    double   lowerBound  (size_t);
+    double   upperBound  (size_t);
+    size_t   columnsCount();
+    size_t   rowsCount   ();
+    
+    LPStatus solve       ();
+    double   objValue    ();
+    void     primalValues(vector<double>&);
+    void     dualValues  (vector<double>&);
+    void     reducedCosts(vector<double>&);
+    void     getBasis    (LPBasis&);
+    void     setBasis    (const LPBasis&);
+    long     iterations  ();
+    void     setIterationLimit(long);
+};
+
+#endif /* defined(__TSP__simplex__) */
@@ -0,0 +1,129 @@
+//
+//  stats.cpp
+//  TSP
+//
+//  Statistics of a solve: time per phase, LP and cut counts, the search
+//  tree and the history of the incumbent.
+//
+
+#include "stats.h"
+#include "util.h"
+#include <iomanip>
+#include <math.h>
+
+PhaseTimer::PhaseTimer(PhaseTime& time, bool thread) : _time(time), _thread(thread) {
+    _wall = chrono::steady_clock::now();
+    _cpu  = _thread ? Utility::threadZeit() : Utility::zeit();
+}
+
+PhaseTimer::~PhaseTimer() {
+    _time.wall += chrono::duration<double>(chrono::steady_clock::now() - _wall).count();
+    _time.cpu  += (_thread ? Utility::threadZeit() : Utility::zeit()) - _cpu;
+}
+
+SolveStatistics::SolveStatistics() {
+    lpSolves      = 0;
+    lpIterations  = 0;
+    nodesExplored = 0;
+    nodesPruned   = 0;
+    nodesOpen     = 0;
+    maxDepth      = 0;
+    tourLength    = INFINITY;
+    lowerBound    = 0;
+    gap           = 0;
+    for (int t = 0; t < CUT_TYPES; t++)
+        cuts[t] = 0;
+}
+
+const char* SolveStatistics::phaseName(SolvePhase phase) {
+    const char* names[] = {"load", "model build", "heuristic", "dynamic program", "LP", "separation", "branching"};
+    return names[phase];
+}
+
+const char* SolveStatistics::cutName(CutType type) {
+    const char* names[] = {"subtour", "blossom", "comb", "pool"};
+    return names[type];
+}
+
+void SolveStatistics::printTable(ostream& out) const {
+    ios::fmtflags flags     = out.flags();
+    streamsize    precision = out.precision();
+    out.setf(ios::fixed, ios::floatfield);
+    out.precision(3);
+
+    out << left << setw(18) << "Phase" << right << setw(12) << "Wall (s)" << setw(12) << "CPU (s)" << endl;
+    for (int p = 0; p < PHASE_COUNT; p++)
+        out << left << setw(18) << phaseName((SolvePhase) p) << right << setw(12) << phases[p].wall << setw(12) << phases[p].cpu << endl;
+    out << left << setw(18) << "total" << right << setw(12) << total.wall << setw(12) << total.cpu << endl;
+
+    out << left << setw(18) << "LP solves" << right << setw(12) << lpSolves << endl;
+    out << left << setw(18) << "LP iterations" << right << setw(12) << lpIterations << endl;
+    for (int t = 0; t < CUT_TYPES; t++)
+        out << left << setw(18) << (string(cutName((CutType) t)) + " cuts") << right << setw(12) << cuts[t] << endl;
+    out << left << setw(18) << "nodes explored" << right << setw(12) << nodesExplored << endl;
+    out << left << setw(18) << "nodes pruned" << right << setw(12) << nodesPruned << endl;
+    out << left << setw(18) << "nodes open" << right << setw(12) << nodesOpen << endl;
+    out << left << setw(18) << "max depth" << right << setw(12) << maxDepth << endl;
+    out << left << setw(18) << "gap (%)" << right << setw(12) << 100 * gap << endl;
+
+    out << left << setw(18) << "Incumbent" << right << setw(12) << "Time (s)" << setw(12) << "Nodes" << endl;
+    for (const IncumbentUpdate& u : incumbents)
+        out << left << setw(18) << u.length << right << setw(12) << u.time << setw(12) << u.nodes << endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+// JSON has no infinity, so a missing tour is written as null
+static void jsonNumber(ostream& out, double value) {
+    if (isfinite(value))
+        out << value;
+    else
+        out << "null";
+}
+
+static void jsonPhase(ostream& out, const char* name, const PhaseTime& time) {
+    out << "\"" << name << "\": {\"wall\": ";
+    jsonNumber(out, time.wall);
+    out << ", \"cpu\": ";
+    jsonNumber(out, time.cpu);
+    out << "}";
+}
+
+void SolveStatistics::printJSON(ostream& out) const {
+    ios::fmtflags flags     = out.flags();
+    streamsize    precision = out.precision();
+    out.unsetf(ios::floatfield);
+    out.precision(17);
+
+    out << "{\n  \"phases\": {";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        jsonPhase(out, phaseName((SolvePhase) p), phases[p]);
+        out << ", ";
+    }//for
+    jsonPhase(out, "total", total);
+    out << "},\n";
+    out << "  \"lp\": {\"solves\": " << lpSolves << ", \"iterations\": " << lpIterations << "},\n";
+    out << "  \"cuts\": {";
+    for (int t = 0; t < CUT_TYPES; t++)
+        out << (t ? ", " : "") << "\"" << cutName((CutType) t) << "\": " << cuts[t];
+    out << "},\n";
+    out << "  \"nodes\": {\"explored\": " << nodesExplored << ", \"pruned\": " << nodesPruned
+        << ", \"open\": " << nodesOpen << ", \"maxDepth\": " << maxDepth << "},\n";
+    out << "  \"incumbents\": [";
+    for (size_t k = 0; k < incumbents.size(); k++) {
+        out << (k ? ", " : "") << "{\"time\": ";
+        jsonNumber(out, incumbents[k].time);
+        out << ", \"length\": ";
+        jsonNumber(out, incumbents[k].length);
+        out << ", \"nodes\": " << incumbents[k].nodes << "}";
+    }//for
+    out << "],\n  \"tourLength\": ";
+    jsonNumber(out, tourLength);
+    out << ",\n  \"lowerBound\": ";
+    jsonNumber(out, lowerBound);
+    out << ",\n  \"gap\": ";
+    jsonNumber(out, gap);
+    out << "\n}" << endl;
+    out.flags(flags);
+    out.precision(precision);
+}
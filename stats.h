@@ -0,0 +1,82 @@
+//
+//  stats.h
+//  TSP
+//
+//  Statistics of a solve: time per phase, LP and cut counts, the search
+//  tree and the history of the incumbent.
+//
+
+#ifndef __TSP__stats__
+#define __TSP__stats__
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <chrono>
+using namespace std;
+
+enum SolvePhase {LOAD_PHASE, MODEL_PHASE, HEURISTIC_PHASE, DP_PHASE, LP_PHASE, SEPARATION_PHASE, BRANCHING_PHASE, PHASE_COUNT};
+
+// Cuts by where they came from: subtour constraints, from the islands
+// of the support graph or the exact separation, blossoms, combs with
+// larger teeth, and cuts of the pool put back into the LP
+enum CutType {SUBTOUR_CUT, BLOSSOM_CUT, COMB_CUT, POOL_CUT, CUT_TYPES};
+
+struct PhaseTime {
+    double wall;
+    double cpu;
+
+    PhaseTime() : wall(0), cpu(0) {}
+    PhaseTime& operator+= (const PhaseTime& t) { wall += t.wall; cpu += t.cpu; return *this; }
+};
+
+// A new best tour: seconds since the start of the solve, its length and
+// the number of nodes solved by then
+struct IncumbentUpdate {
+    double time;
+    double length;
+    long   nodes;
+};
+
+// Adds the wall and CPU time of its scope to a phase. Phases of the
+// search are timed on each worker with the CPU time of its thread and
+// summed over the workers, so they can exceed the running time; the
+// other phases take the CPU time of the whole process, threads they
+// start included.
+class PhaseTimer {
+private:
+    PhaseTime&                        _time;
+    bool                              _thread;
+    chrono::steady_clock::time_point  _wall;
+    double                            _cpu;
+
+public:
+    PhaseTimer(PhaseTime&, bool = true);
+    ~PhaseTimer();
+};
+
+struct SolveStatistics {
+    PhaseTime                 total;
+    PhaseTime                 phases[PHASE_COUNT];
+    long                      lpSolves;
+    long                      lpIterations;
+    long                      cuts[CUT_TYPES];
+    long                      nodesExplored;
+    long                      nodesPruned;
+    long                      nodesOpen;
+    long                      maxDepth;
+    vector<IncumbentUpdate>   incumbents;
+    double                    tourLength;
+    double                    lowerBound;
+    double                    gap;
+
+    SolveStatistics();
+
+    void printTable(ostream&) const;
+    void printJSON (ostream&) const;
+
+    static const char* phaseName(SolvePhase);
+    static const char* cutName  (CutType);
+};
+
+#endif /* defined(__TSP__stats__) */
@@ -0,0 +1,163 @@
+//
+//  tourdp.cpp
+//  TSP
+//
+//  Exact tours of small graphs by the dynamic program of Held and Karp
+//  over subsets of nodes.
+//
+
+#include "tourdp.h"
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define X86_MIN_KERNELS
+#endif
+
+#define NO_EDGE         ((size_t) -1)
+#define DP_MAX_BITS     40
+
+// Kernels computing the minimum of a[i] + b[i]. Every sum is rounded the
+// same way in each kernel and the minimum does not depend on the order,
+// so all of them return the same value, which the trace back relies on.
+typedef double (*MinPlusKernel)(const double*, const double*, size_t);
+
+static double scalarMinPlus(const double* a, const double* b, size_t count) {
+    double re = INFINITY;
+    for (size_t i = 0; i < count; i++)
+        re = min(re, a[i] + b[i]);
+    return re;
+}
+
+#ifdef X86_MIN_KERNELS
+__attribute__((target("avx")))
+static double avxMinPlus(const double* a, const double* b, size_t count) {
+    __m256d vmin = _mm256_set1_pd(INFINITY);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        vmin = _mm256_min_pd(vmin, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vmin);
+    double re = min(min(lanes[0], lanes[1]), min(lanes[2], lanes[3]));
+    return min(re, scalarMinPlus(a + i, b + i, count - i));
+}
+
+__attribute__((target("avx512f")))
+static double avx512MinPlus(const double* a, const double* b, size_t count) {
+    __m512d vmin = _mm512_set1_pd(INFINITY);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        vmin = _mm512_min_pd(vmin, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    // The tail is masked so that the short rows of small graphs also go
+    // through the vector unit
+    if (i < count) {
+        __mmask8 mask = (__mmask8) ((1u << (count - i)) - 1);
+        __m512d  inf  = _mm512_set1_pd(INFINITY);
+        __m512d  va   = _mm512_mask_loadu_pd(inf, mask, a + i);
+        __m512d  vb   = _mm512_mask_loadu_pd(inf, mask, b + i);
+        vmin = _mm512_min_pd(vmin, _mm512_add_pd(va, vb));
+    }//if
+    return _mm512_reduce_min_pd(vmin);
+}
+#endif
+
+static MinPlusKernel selectMinPlusKernel() {
+#ifdef X86_MIN_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return avx512MinPlus;
+    if (__builtin_cpu_supports("avx"))
+        return avxMinPlus;
+#endif
+    return scalarMinPlus;
+}
+
+static double minPlus(const double* a, const double* b, size_t count) {
+    static MinPlusKernel kernel = selectMinPlusKernel();
+    return kernel(a, b, count);
+}
+
+TourDP::TourDP(Graph& graph, unsigned long long memoryLimit) {
+    _edges       = graph.edges();
+    _ncount      = graph.nodesCount();
+    _memoryLimit = memoryLimit;
+    _weights.assign(_ncount * _ncount, INFINITY);
+    _edgeIds.assign(_ncount * _ncount, NO_EDGE);
+    for (size_t i = 0; i < _edges.size(); i++) {
+        Identifier u = _edges[i].source();
+        Identifier v = _edges[i].destination();
+        if (u == v || _edges[i].weight() >= _weights[u * _ncount + v]) continue;
+        _weights[u * _ncount + v] = _weights[v * _ncount + u] = _edges[i].weight();
+        _edgeIds[u * _ncount + v] = _edgeIds[v * _ncount + u] = i;
+    }//for
+}
+
+// Bytes of the table for a graph of the given size
+unsigned long long TourDP::tableBytes(size_t ncount) {
+    if (ncount < 2)
+        return 0;
+    if (ncount - 1 > DP_MAX_BITS)
+        return ~0ULL;
+    return (1ULL << (ncount - 1)) * (ncount - 1) * sizeof(double);
+}
+
+// Fills tour with a shortest tour starting at node 0 and returns its
+// length, or INFINITY when the graph has no tour
+double TourDP::optimumTour(vector<Identifier>& tour) const {
+    tour.clear();
+    if (_ncount < 3)
+        return INFINITY;
+    if (tableBytes(_ncount) > _memoryLimit)
+        throw "Dynamic program exceeds its memory limit!";
+
+    // Set bit i stands for node i + 1
+    size_t         m    = _ncount - 1;
+    size_t         sets = (size_t) 1 << m;
+    vector<double> table(sets * m);
+    for (size_t s = 1; s < sets; s++) {
+        double* row = &table[s * m];
+        for (size_t i = 0; i < m; i++) {
+            if (!(s >> i & 1))
+                row[i] = INFINITY;
+            else if (s == ((size_t) 1 << i))
+                row[i] = _weights[i + 1];
+            else
+                row[i] = minPlus(&table[(s ^ ((size_t) 1 << i)) * m], &_weights[(i + 1) * _ncount + 1], m);
+        }//for
+    }//for
+
+    size_t s      = sets - 1;
+    double length = minPlus(&table[s * m], &_weights[1], m);
+    if (length == INFINITY)
+        return INFINITY;
+
+    // Trace back: the node before i is one whose entry explains i's
+    Identifier last = INVALID_ID;
+    for (size_t i = 0; i < m; i++)
+        if (table[s * m + i] + _weights[i + 1] == length)
+            last = i;
+    tour.push_back(0);
+    while (s != 0) {
+        tour.push_back(last + 1);
+        size_t rest = s ^ ((size_t) 1 << last);
+        if (rest != 0) {
+            for (size_t i = 0; i < m; i++)
+                if (table[rest * m + i] + _weights[(last + 1) * _ncount + i + 1] == table[s * m + last]) {
+                    last = i;
+                    break;
+                }//if
+        }//if
+        s = rest;
+    }//while
+    return length;
+}
+
+// LP values of a tour: 1 for the lightest edge between consecutive nodes
+void TourDP::tourEdges(const vector<Identifier>& tour, vector<double>& vals) const {
+    vals.assign(_edges.size(), 0);
+    for (size_t k = 0; k < tour.size(); k++) {
+        size_t id = _edgeIds[tour[k] * _ncount + tour[(k + 1) % tour.size()]];
+        if (id != NO_EDGE)
+            vals[id] = 1;
+    }//for
+}
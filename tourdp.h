@@ -0,0 +1,50 @@
+//
+//  tourdp.h
+//  TSP
+//
+//  Exact tours of small graphs by the dynamic program of Held and Karp
+//  over subsets of nodes.
+//
+
+#ifndef __TSP__tourdp__
+#define __TSP__tourdp__
+
+#include <vector>
+#ifndef __LP__datastructs__
+#include "datastructs.h"
+#endif
+using namespace std;
+
+#define DP_MAX_NODES      13
+#define DP_MEMORY_LIMIT   (256ULL << 20)
+
+// The length of the shortest path from node 0 through the set S of other
+// nodes that ends at v in S is
+//   d(S, v) = min over u in S - {v} of d(S - {v}, u) + w(u, v),
+// so the whole table takes O(2^n n^2) time and 2^(n-1) (n-1) doubles.
+// The table has one row of n-1 entries per set, the entries of the
+// nodes outside the set being infinite, and the weights form a full
+// symmetric matrix, so every minimum runs over two contiguous rows, with
+// vector instructions where the processor has them. The tour is traced
+// back through the table without storing predecessors.
+//
+// Pairs of nodes without an edge have infinite weight; parallel edges
+// keep the lightest one.
+class TourDP {
+private:
+    ArrayView<Edge>      _edges;
+    size_t               _ncount;
+    unsigned long long   _memoryLimit;
+    vector<double>       _weights;
+    vector<size_t>       _edgeIds;
+
+public:
+    TourDP(Graph&, unsigned long long = DP_MEMORY_LIMIT);
+
+    double optimumTour(vector<Identifier>&) const;
+    void   tourEdges  (const vector<Identifier>&, vector<double>&) const;
+
+    static unsigned long long tableBytes(size_t);
+};
+
+#endif /* defined(__TSP__tourdp__) */
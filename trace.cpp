@@ -0,0 +1,87 @@
+//
+//  trace.cpp
+//  TSP
+//
+//  Timeline of the search in the Chrome trace-event format, only
+//  compiled with -DTSP_TRACE.
+//
+
+#include "trace.h"
+
+#ifdef TSP_TRACE
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+
+struct TraceBuffer {
+    int                 tid;
+    vector<TraceEvent>  events;
+    size_t              next;
+    bool                wrapped;
+};
+
+static mutex                              registryLock;
+static vector<TraceBuffer*>               buffers;
+static chrono::steady_clock::time_point   origin = chrono::steady_clock::now();
+static thread_local TraceBuffer*          local  = NULL;
+
+// Microseconds since the program started
+double Trace::now() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - origin).count();
+}
+
+void Trace::record(const char* name, double start, double duration, double value) {
+    if (local == NULL) {
+        lock_guard<mutex> guard(registryLock);
+        local          = new TraceBuffer();
+        local->tid     = (int) buffers.size();
+        local->next    = 0;
+        local->wrapped = false;
+        local->events.resize(TRACE_BUFFER_EVENTS);
+        buffers.push_back(local);
+    }//if
+
+    TraceEvent& e = local->events[local->next];
+    e.name     = name;
+    e.start    = start;
+    e.duration = duration;
+    e.value    = value;
+    if (++local->next == TRACE_BUFFER_EVENTS) {
+        local->next    = 0;
+        local->wrapped = true;
+    }//if
+}
+
+// Writes the events of all threads, oldest first within each thread;
+// chrome://tracing and Perfetto open the file
+void Trace::write(const string& path) {
+    lock_guard<mutex> guard(registryLock);
+    ofstream out(path.c_str());
+    if (!out)
+        throw "Could not open the trace file!";
+
+    out.setf(ios::fixed, ios::floatfield);
+    out.precision(3);
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (TraceBuffer* b : buffers) {
+        size_t count = b->wrapped ? TRACE_BUFFER_EVENTS : b->next;
+        size_t begin = b->wrapped ? b->next : 0;
+        for (size_t k = 0; k < count; k++) {
+            const TraceEvent& e = b->events[(begin + k) % TRACE_BUFFER_EVENTS];
+            out << (first ? "\n" : ",\n") << "{\"name\": \"" << e.name << "\", \"pid\": 1, \"tid\": " << b->tid
+                << ", \"ts\": " << e.start;
+            if (e.duration < 0)
+                out << ", \"ph\": \"i\", \"s\": \"t\"";
+            else
+                out << ", \"ph\": \"X\", \"dur\": " << e.duration;
+            out << ", \"args\": {\"value\": " << e.value << "}}";
+            first = false;
+        }//for
+    }//for
+    out << "\n], \"displayTimeUnit\": \"ms\"}" << endl;
+}
+
+#endif
@@ -0,0 +1,67 @@
+//
+//  trace.h
+//  TSP
+//
+//  Timeline of the search in the Chrome trace-event format, only
+//  compiled with -DTSP_TRACE.
+//
+
+#ifndef __TSP__trace__
+#define __TSP__trace__
+
+#define TRACE_FILE           "tsp_trace.json"
+
+#ifdef TSP_TRACE
+
+#include <string>
+using namespace std;
+
+#define TRACE_BUFFER_EVENTS  65536
+
+// A scoped event lasting duration microseconds from start, or an instant
+// event when the duration is negative, with one value to show with it
+struct TraceEvent {
+    const char* name;
+    double      start;
+    double      duration;
+    double      value;
+};
+
+// Each thread records into a ring buffer of its own, so recording takes
+// no lock; a buffer keeps the last TRACE_BUFFER_EVENTS events of its
+// thread and outlives it. write() must run once the threads are done,
+// as at the end of the program.
+class Trace {
+public:
+    static double now   ();
+    static void   record(const char*, double, double, double);
+    static void   write (const string&);
+};
+
+class TraceScope {
+private:
+    const char* _name;
+    double      _value;
+    double      _start;
+
+public:
+    TraceScope(const char* name, double value) : _name(name), _value(value), _start(Trace::now()) {}
+    ~TraceScope() { Trace::record(_name, _start, Trace::now() - _start, _value); }
+};
+
+#define TRACE_CONCAT_(a, b)          a##b
+#define TRACE_CONCAT(a, b)           TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, value)     TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, value)
+#define TRACE_INSTANT(name, value)   Trace::record(name, Trace::now(), -1, value)
+#define TRACE_WRITE(path)            Trace::write(path)
+
+#else
+
+// Without TSP_TRACE the events cost nothing
+#define TRACE_SCOPE(name, value)
+#define TRACE_INSTANT(name, value)
+#define TRACE_WRITE(path)
+
+#endif
+
+#endif /* defined(__TSP__trace__) */
@@ -7,10 +7,15 @@
 //
 
 #include "tsp.h"
+#include "util.h"
+#include "trace.h"
 #include <sstream>
 #include <map>
 #include <stack>
 #include <memory>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 #define NO_CONSTRAINT           -1
 #define SELECT_EDGE_CONSTRAINT  1
@@ -21,99 +26,216 @@
 #define SELECT_EDGE_LB          (SELECT_EDGE - LP_EPSILON)
 #define IGNORE_EDGE_UB          (IGNORE_EDGE + LP_EPSILON)
 
-TravellingSalesperson::TravellingSalesperson() : _env(), _model(_env), _X(_env), _bestSolVals(_env) {
-    
+#define MAX_SUBTOUR_CUTS        50
+#define MAX_COMB_CUTS           50
+#define MAX_POOL_CUTS           100
+
+#define NODES_PER_BATCH         4
+#define NO_OWNER                -1
+
+#define STRONG_CANDIDATES       10
+#define STRONG_ITERATIONS       25
+#define PSEUDOCOST_RELIABILITY  4
+#define PSEUDOCOST_LOOKAHEAD    4
+#define SCORE_EPSILON           1e-6
+
+#define ROUNDING_INTERVAL       10
+#define NNA_STARTS              16
+
+TravellingSalesperson::TravellingSalesperson(LPBackend backend) : _adjacency(NULL), _backend(backend), _combCuts(true), _threads(1), _deterministic(false), _branchRule(PSEUDOCOST_BRANCHING), _selection(BEST_BOUND), _nodeMemory(0), _localSearch(LIN_KERNIGHAN), _dpNodes(DP_MAX_NODES), _improver(NULL), _oneTree(false), _treeBound(NULL), _rootFrac(0), _tval(INFINITY), _openNodes(0), _timeLimit(0), _nodeLimit(0), _relativeGap(0), _absoluteGap(0), _stopped(false), _nodesDone(0), _status(SOLVED_OPTIMAL), _eliminatedCount(0) {
+    runTime      = 0;
+    lpSolves     = 0;
+    lpIterations = 0;
+    bbNodes      = 0;
+    rootBound    = 0;
+    poolSize     = 0;
+    maxRows      = 0;
+    maxOpen      = 0;
+    maxSpilled   = 0;
+    branchings       = 0;
+    localFixes       = 0;
+    heuristicTours   = 0;
+    initialTour      = 0;
+    oneTreeRoot      = 0;
+    lowerBound       = 0;
+    treePrunes       = 0;
+    unsolvedNodes    = 0;
+    strongSolves     = 0;
+    strongIterations = 0;
 }
 
 TravellingSalesperson::~TravellingSalesperson() {
-    
+    for (SearchWorker* w : _workers)
+        deleteWorker(w);
+    delete _improver;
+    delete _treeBound;
 }
 
-void TravellingSalesperson::initLPModel() {
-    IloExpr z(_env);
+SearchWorker* TravellingSalesperson::createWorker(int id) {
+    SearchWorker* w  = new SearchWorker();
+    w->id            = id;
+    w->lp            = LPSolver::create(_backend);
+    w->separator     = new SubtourSeparator(*_graph);
+    w->combSeparator = new CombSeparator(*_graph);
+    w->stamp         = 0;
+    w->lpSolves      = 0;
+    w->lpIterations  = 0;
+    w->bbNodes       = 0;
+    w->maxRows       = 0;
+    w->maxOpen       = 0;
+    w->maxSpilled    = 0;
+    w->branchings    = 0;
+    w->localFixes    = 0;
+    w->heuristicTours = 0;
+    w->treePrunes    = 0;
+    w->eliminatedSeen = 0;
+    w->strongSolves  = 0;
+    w->strongIterations = 0;
+    w->prunedNodes   = 0;
+    w->unsolvedNodes = 0;
+    w->maxDepth      = 0;
+    for (int t = 0; t < CUT_TYPES; t++)
+        w->cuts[t] = 0;
+    w->nodes         = new NodeQueue(_selection, _nodeMemory / max(_threads, (size_t) 1));
+    w->constraints.assign(_edges.size(), NO_CONSTRAINT);
+    w->eliminated.assign(_edges.size(), false);
+    w->downGain.assign(_edges.size(), 0);
+    w->upGain.assign(_edges.size(), 0);
+    w->downCount.assign(_edges.size(), 0);
+    w->upCount.assign(_edges.size(), 0);
     
-    // Create a variable for each edge and creating the objective function
-    size_t count = 0;
-    for (Edge e : _edges) {
-        stringstream ss;
-        ss << "x" << count;
-        _X.add(IloNumVar(_env, IGNORE_EDGE, SELECT_EDGE, ILOFLOAT, ss.str().c_str()));
-        z += e.weight() * _X[count++];
-    }//for
+    initLPModel(*w);
+    w->pool = new CutPool(*_graph, w->lp->rowsCount());
+    return w;
+}
+
+void TravellingSalesperson::deleteWorker(SearchWorker* w) {
+    delete w->lp;
+    delete w->separator;
+    delete w->combSeparator;
+    delete w->pool;
+    delete w->nodes;
+    delete w;
+}
+
+void TravellingSalesperson::initLPModel(SearchWorker& w) {
+    // Create a variable for each edge, its cost being the edge weight
+    for (const Edge& e : _edges)
+        w.lp->addColumn(e.weight(), IGNORE_EDGE, SELECT_EDGE);
     
     // Adding initialize constraints:
     //  - For each node, we force that at least two edges should be chosen
-    _adjancyMatrix = _graph->sortedAdjancyMatrix();
-    for (auto elist: _adjancyMatrix) {
-        IloExpr nodeConstraint(_env);
-        
-        for (Edge e: elist)
-            nodeConstraint += _X[e.identifier()];
-        _model.add((nodeConstraint == 2));
+    size_t ncount = _graph->nodesCount();
+    vector<size_t> cols;
+    vector<double> coefs;
+    for (size_t v = 0; v < ncount; v++) {
+        ArrayView<Identifier> ids = _adjacency->edgeIds(v);
+        cols.assign(ids.begin(), ids.end());
+        coefs.assign(ids.size(), 1.0);
+        w.lp->addRow(cols, coefs, 2, 2);
     }//for
-    
-    _model.add(IloMinimize(_env, z));
 }
 
-IloCplex TravellingSalesperson::solveLP() {
-    IloCplex cplex(_model);
-    cplex.setOut(_env.getNullStream());
-    cplex.solve();
-    return cplex;
+LPStatus TravellingSalesperson::solveLP(SearchWorker& w) {
+    LPStatus status;
+    {
+        PhaseTimer timer(w.phases[LP_PHASE]);
+        TRACE_SCOPE("solveLP", w.lp->rowsCount());
+        status = w.lp->solve();
+    }
+    w.lpSolves++;
+    w.lpIterations += w.lp->iterations();
+    w.maxRows       = max(w.maxRows, w.lp->rowsCount());
+    if (status == LP_OPTIMAL) {
+        w.lp->primalValues(w.vals);
+        w.pool->age(w.vals);
+        w.pool->purge(*w.lp);
+    }//if
+    return status;
 }
 
-IloCplex TravellingSalesperson::connect(IloCplex solution) {
-    while(solution.getStatus() != IloAlgorithm::Infeasible) {
-        DisjointSets islands(_graph->nodesCount());
-        IloNumArray vals(_env);
-        solution.getValues(vals, _X);
+LPStatus TravellingSalesperson::connect(SearchWorker& w, LPStatus status) {
+    while(status == LP_OPTIMAL) {
+        {
+            PhaseTimer timer(w.phases[SEPARATION_PHASE]);
+            TRACE_SCOPE("separation", w.pool->size());
+            DisjointSets islands(_graph->nodesCount());
 
-        // Find islands
-        size_t edgesCount = _graph->edgesCount();
-        vector<Edge> notSelectedEdges;
-        notSelectedEdges.reserve(edgesCount);
-        for (size_t i = 0; i < edgesCount; i++) {
-            if (vals[i] > LP_EPSILON)
-                islands.merge(_edges[i].source(), _edges[i].destination());
-            else
-                notSelectedEdges.push_back(_edges[i]);
-        }//for
-        
-        if (islands.count() == 1) break;
-        
-        //Construct constraints for not connected islands
-        map<Identifier, IloExpr> mapComp;
-        map<Identifier, IloExpr> map;
-        for (Edge e : notSelectedEdges) {
-            Identifier srcIslandId = islands.find(e.source());
-            Identifier dstIslandId = islands.find(e.destination());
+            // Find islands
+            size_t edgesCount = _graph->edgesCount();
+            for (size_t i = 0; i < edgesCount; i++)
+                if (w.vals[i] > LP_EPSILON)
+                    islands.merge(_edges[i].source(), _edges[i].destination());
             
-            if (srcIslandId != dstIslandId) {
-                addEdgeToConstraints(e, srcIslandId, map);
-                addEdgeToConstraints(e, dstIslandId, map);
+            // A connected support graph can still have cuts carrying less
+            // than 2, which only the exact separation finds. Once there are
+            // none, blossoms and combs tighten the relaxation further. Cuts
+            // of the pool are cheaper to check than any separation.
+            if (islands.count() == 1) {
+                if (!addPoolCuts(w) && !addSubtourCuts(w) && !(_combCuts && addCombCuts(w))) break;
             }//if
-//            else {
-//                addEdgeComponentConstraints(e, islands, mapComp);
-//            }//else
-        }//for
+            else {
+                // At least there should be two edges leaving every island
+                vector<Cut> cuts;
+                for (Identifier v = 0; v < (Identifier) _graph->nodesCount(); v++) {
+                    if (islands.find(v) != v) continue;
+                    Cut cut;
+                    cut.nodes = islands.set(v);
+                    cut.value = 0;
+                    sort(cut.nodes.begin(), cut.nodes.end());
+                    cuts.push_back(cut);
+                }//for
+                addCuts(w, cuts);
+            }//else
+        }
         
-        // Add constraints to model
-        // At least there should be two edges between a pair of islands
-        for (std::map<Identifier, IloExpr>::iterator it = map.begin(); it != map.end(); it++) {
-            _model.add(it->second >= 2);
-        }//for
-        // The number of edges cannot be more than (#nodes - 1) in each island
-//        for (std::map<Identifier, IloExpr>::iterator it = mapComp.begin(); it != mapComp.end(); it++) {
-//            _model.add(it->second <= ((int)islands.set(it->first).size() - 1));
-//        }//for
-        
-        solution = solveLP();
+        status = solveLP(w);
     }//while
     
-    return solution;
+    return status;
 }
 
-double TravellingSalesperson::nna(Identifier startNode) {
+// Puts cuts of the pool violated by the current solution back into the
+// LP; false if there are none
+bool TravellingSalesperson::addPoolCuts(SearchWorker& w) {
+    size_t added = w.pool->separate(w.vals, MAX_POOL_CUTS, *w.lp);
+    w.cuts[POOL_CUT] += added;
+    return added > 0;
+}
+
+// Adds the most violated subtour constraints of the current solution;
+// false if there are none
+bool TravellingSalesperson::addSubtourCuts(SearchWorker& w) {
+    vector<Cut> cuts;
+    w.separator->separate(w.vals, MAX_SUBTOUR_CUTS, cuts);
+    return addCuts(w, cuts);
+}
+
+// Adds the most violated blossoms and combs; false if none were found
+bool TravellingSalesperson::addCombCuts(SearchWorker& w) {
+    vector<Cut> cuts;
+    w.combSeparator->separate(w.vals, MAX_COMB_CUTS, cuts);
+    return addCuts(w, cuts);
+}
+
+// Adds cuts through the pool; false if all of them were in the LP already
+bool TravellingSalesperson::addCuts(SearchWorker& w, const vector<Cut>& cuts) {
+    bool re = false;
+    for (const Cut& cut : cuts) {
+        if (!w.pool->add(cut, *w.lp)) continue;
+        re = true;
+        if (cut.teeth.empty())
+            w.cuts[SUBTOUR_CUT]++;
+        else if (all_of(cut.teeth.begin(), cut.teeth.end(), [](const vector<Identifier>& t) { return t.size() == 2; }))
+            w.cuts[BLOSSOM_CUT]++;
+        else
+            w.cuts[COMB_CUT]++;
+    }//for
+    return re;
+}
+
+// The nearest neighbor tour from startNode; its nodes are left in tour
+double TravellingSalesperson::nna(vector<Identifier>& tour, Identifier startNode) {
     size_t ncount = _graph->nodesCount();
     vector<bool> nselected(ncount, false);
     
@@ -121,26 +243,32 @@ double TravellingSalesperson::nna(Identifier startNode) {
     
     Identifier nextNode = startNode;
     nselected[nextNode] = true;
+    tour.assign(1, startNode);
     for (size_t i = 0; i < ncount; i++) {
+        ArrayView<Identifier> neighbors = _adjacency->neighbors(nextNode);
+        ArrayView<Identifier> edgeIds   = _adjacency->edgeIds(nextNode);
         size_t j = 0;
-        for (; j < _adjancyMatrix[nextNode].size(); j++) {
-            Identifier nodeId = _adjancyMatrix[nextNode][j].otherEndpoint(nextNode);
+        for (; j < neighbors.size(); j++) {
+            Identifier nodeId = neighbors[j];
             if (!nselected[nodeId]) {
                 //select this node
-                cost += _adjancyMatrix[nextNode][j].weight();
+                cost += _edges[edgeIds[j]].weight();
                 nextNode = nodeId;
                 nselected[nextNode] = true;
+                tour.push_back(nextNode);
                 break;
             }//if
         }//for
-        if (j == _adjancyMatrix[nextNode].size()) break;
+        if (j == neighbors.size()) break;
     }//for
     
     //Check Cycle
     bool foundLastEdge = false;
-    for (Edge e: _adjancyMatrix[nextNode]) {
-        if (e.otherEndpoint(nextNode) == startNode) {
-            cost += e.weight();
+    ArrayView<Identifier> neighbors = _adjacency->neighbors(nextNode);
+    ArrayView<Identifier> edgeIds   = _adjacency->edgeIds(nextNode);
+    for (size_t j = 0; j < neighbors.size(); j++) {
+        if (neighbors[j] == startNode) {
+            cost += _edges[edgeIds[j]].weight();
             foundLastEdge = true;
             break;
         }//if
@@ -158,24 +286,66 @@ double TravellingSalesperson::nna(Identifier startNode) {
     return re;
 }
 
+// The first incumbent: the shortest of the nearest neighbor tours from
+// NNA_STARTS random nodes, the greedy edge tour, the space-filling curve
+// tour, for geo graphs only, and the Christofides tour, each improved by
+// local search. The heuristics run on the search threads; ties go to the
+// earlier one in that list, so the result does not depend on the timing.
 double TravellingSalesperson::upperBound() {
-    Identifier randNode = random() % _graph->nodesCount();
-    double re = nna(_graph->node(randNode).identifier());
-    if(re == NOT_VALID_TOUR_LEN) re = INFINITY;
-    return re;
+    size_t ncount = _graph->nodesCount();
+    vector<Identifier> starts;
+    for (size_t k = 0; k < min(ncount, (size_t) NNA_STARTS); k++)
+        starts.push_back(_graph->node(random() % ncount).identifier());
+    
+    const char* names[] = {"greedy", "space-filling curve", "christofides"};
+    TourConstructor              constructor(*_graph);
+    size_t                       tasks = starts.size() + 3;
+    vector<vector<Identifier> >  tours(tasks);
+    vector<double>               lengths(tasks, INFINITY);
+    atomic<size_t>               nextTask(0);
+    auto work = [&]() {
+        for (size_t k = nextTask++; k < tasks; k = nextTask++) {
+            vector<Identifier>& tour = tours[k];
+            if (k < starts.size()) {
+                if (nna(tour, starts[k]) == NOT_VALID_TOUR_LEN) continue;
+            }//if
+            else if (k == starts.size())
+                _improver->roundLP(vector<double>(), tour);
+            else if (k == starts.size() + 1) {
+                if (!_graph->isGeo()) continue;
+                constructor.spaceFillingCurve(tour);
+            }//else if
+            else
+                constructor.christofides(tour);
+            lengths[k] = _improver->improve(tour);
+        }//for
+    };
+    vector<thread> threads;
+    for (size_t k = 1; k < _threads && k < tasks; k++)
+        threads.push_back(thread(work));
+    work();
+    for (thread& t : threads)
+        t.join();
+    
+    size_t best = min_element(lengths.begin(), lengths.end()) - lengths.begin();
+    if (lengths[best] == INFINITY) {
+        _initialHeuristic = "none";
+        return INFINITY;
+    }//if
+    _initialHeuristic = (best < starts.size()) ? "nearest neighbor" : names[best - starts.size()];
+    _improver->edgeValues(tours[best], _bestSolVals);
+    return lengths[best];
 }
 
 // We assume that the if degree of each node is 2, and the graph is connected
-bool TravellingSalesperson::isTour(IloCplex solution) {
+bool TravellingSalesperson::isTour(SearchWorker& w) {
     bool re = true;
     
     size_t ncount = _graph->nodesCount();
     size_t ecount = _graph->edgesCount();
     vector<int> edgesCount(ncount, 0);
-    IloNumArray vals(_env);
-    solution.getValues(vals, _X);
     for (size_t i = 0; i < ecount; i++) {
-        if (vals[i] >= SELECT_EDGE_LB) {
+        if (w.vals[i] >= SELECT_EDGE_LB) {
 //            cout << _edges[i].source() << "-" << _edges[i].destination() << ": " << _edges[i].weight() << endl;
             edgesCount[_edges[i].source()] ++;
             edgesCount[_edges[i].destination()] ++;
@@ -192,14 +362,36 @@ bool TravellingSalesperson::isTour(IloCplex solution) {
     return re;
 }
 
-Identifier TravellingSalesperson::edgeToBranch(IloCplex& lp, vector<int>& constraints) {
+// Product of the bound gains of the two children
+static double branchScore(double down, double up) {
+    return max(down, SCORE_EPSILON) * max(up, SCORE_EPSILON);
+}
+
+// The edge to branch on at a node with LP value lpval, by the branching
+// rule; INVALID_ID when every free edge is integral
+Identifier TravellingSalesperson::edgeToBranch(SearchWorker& w, double lpval) {
     size_t ecount = _graph->edgesCount();
-    IloNumArray vals(_env);
-    lp.getValues(vals, _X);
+    
+    if (_branchRule == STRONG_BRANCHING) {
+        vector<pair<double, Identifier> > fractional;
+        for (size_t i = 0; i < ecount; i++)
+            if (w.vals[i] < SELECT_EDGE_LB && w.vals[i] > IGNORE_EDGE_UB && w.constraints[i] == NO_CONSTRAINT)
+                fractional.push_back(make_pair(-min(w.vals[i], 1 - w.vals[i]), i));
+        sort(fractional.begin(), fractional.end());
+        
+        vector<Identifier> candidates;
+        for (size_t k = 0; k < fractional.size(); k++)
+            candidates.push_back(fractional[k].second);
+        return strongBranch(w, lpval, candidates, STRONG_CANDIDATES);
+    }//if
+    else if (_branchRule == PSEUDOCOST_BRANCHING)
+        return pseudocostBranch(w, lpval);
+    else if (_branchRule != FIRST_FRACTIONAL)
+        return mostFractional(w);
     
     Identifier _check = INVALID_ID;
     for (size_t i = 0; i < ecount; i++) {
-        if (vals[i] < SELECT_EDGE_LB && vals[i] > IGNORE_EDGE_UB && constraints[i] == NO_CONSTRAINT) {
+        if (w.vals[i] < SELECT_EDGE_LB && w.vals[i] > IGNORE_EDGE_UB && w.constraints[i] == NO_CONSTRAINT) {
             _check = i;
             break;
         }//if
@@ -208,75 +400,672 @@ Identifier TravellingSalesperson::edgeToBranch(IloCplex& lp, vector<int>& constr
     return _check;
 }
 
-void TravellingSalesperson::branchAndBound(double& tval, long depth, vector<int>& constraints) {
-    depth++;
-//    cout << "Depth: " << depth << endl << endl;
-    IloCplex tmp = solveLP();
-    IloCplex lp  = connect(tmp);
-    if (lp.getStatus() == IloAlgorithm::Infeasible || depth > _edges.size()) {
+Identifier TravellingSalesperson::mostFractional(SearchWorker& w) {
+    Identifier re   = INVALID_ID;
+    double     best = IGNORE_EDGE_UB;
+    for (size_t i = 0; i < _graph->edgesCount(); i++) {
+        double distance = min(w.vals[i], 1 - w.vals[i]);
+        if (distance > best && w.constraints[i] == NO_CONSTRAINT) {
+            best = distance;
+            re   = i;
+        }//if
+    }//for
+    return re;
+}
+
+// Bound gains of fixing edge e to 0 (down) and to 1 (up), from at most
+// STRONG_ITERATIONS dual simplex iterations each; an infeasible child
+// gains INFINITY. The LP goes back to the node's bounds and basis.
+void TravellingSalesperson::strongBounds(SearchWorker& w, Identifier e, double lpval, const LPBasis& basis, double& down, double& up) {
+    double x = w.vals[e];
+    w.lp->setIterationLimit(STRONG_ITERATIONS);
+    for (int side = 0; side < 2; side++) {
+        double value = side ? SELECT_EDGE : IGNORE_EDGE;
+        w.lp->setBounds(e, value, value);
+        LPStatus status = w.lp->solve();
+        w.strongSolves++;
+        w.strongIterations += w.lp->iterations();
+        
+        double gain = 0;
+        if (status == LP_OPTIMAL || status == LP_ITERATION_LIMIT)
+            gain = max(w.lp->objValue() - lpval, 0.0);
+        else if (status == LP_INFEASIBLE)
+            gain = INFINITY;
+        (side ? up : down) = gain;
+        
+        w.lp->setBounds(e, IGNORE_EDGE, SELECT_EDGE);
+        w.lp->setBasis(basis);
+        if (gain < INFINITY)
+            updatePseudocost(w, e, side == 1, side ? 1 - x : x, gain);
+    }//for
+    w.lp->setIterationLimit(0);
+}
+
+// Strong branching over the first limit candidates
+Identifier TravellingSalesperson::strongBranch(SearchWorker& w, double lpval, vector<Identifier>& candidates, size_t limit) {
+    if (candidates.empty())
+        return INVALID_ID;
+    
+    LPBasis basis;
+    w.lp->getBasis(basis);
+    Identifier re        = candidates[0];
+    double     bestScore = -1;
+    for (size_t k = 0; k < candidates.size() && k < limit && bestScore < INFINITY; k++) {
+        double down, up;
+        strongBounds(w, candidates[k], lpval, basis, down, up);
+        double score = branchScore(down, up);
+        if (score > bestScore) {
+            bestScore = score;
+            re        = candidates[k];
+        }//if
+    }//for
+    return re;
+}
+
+// Pseudocost branching with reliability: edges observed fewer than
+// PSEUDOCOST_RELIABILITY times in a direction are strong branched, best
+// predicted first, until PSEUDOCOST_LOOKAHEAD of them in a row fail to
+// improve the best score. Directions never observed use the average
+// pseudocost.
+Identifier TravellingSalesperson::pseudocostBranch(SearchWorker& w, double lpval) {
+    size_t ecount = _graph->edgesCount();
+    double downSum = 0, upSum = 0;
+    long   downObs = 0, upObs = 0;
+    for (size_t i = 0; i < ecount; i++) {
+        if (w.downCount[i] > 0) {
+            downSum += w.downGain[i] / w.downCount[i];
+            downObs++;
+        }//if
+        if (w.upCount[i] > 0) {
+            upSum += w.upGain[i] / w.upCount[i];
+            upObs++;
+        }//if
+    }//for
+    double downAvg = downObs > 0 ? downSum / downObs : 1;
+    double upAvg   = upObs > 0 ? upSum / upObs : 1;
+    
+    vector<pair<double, Identifier> > scored;
+    for (size_t i = 0; i < ecount; i++) {
+        double x = w.vals[i];
+        if (x >= SELECT_EDGE_LB || x <= IGNORE_EDGE_UB || w.constraints[i] != NO_CONSTRAINT) continue;
+        double down = (w.downCount[i] > 0 ? w.downGain[i] / w.downCount[i] : downAvg) * x;
+        double up   = (w.upCount[i] > 0 ? w.upGain[i] / w.upCount[i] : upAvg) * (1 - x);
+        scored.push_back(make_pair(-branchScore(down, up), i));
+    }//for
+    sort(scored.begin(), scored.end());
+    
+    LPBasis    basis;
+    bool       saved     = false;
+    Identifier re        = INVALID_ID;
+    double     bestScore = -1;
+    int        idle      = 0;
+    size_t     strong    = 0;
+    for (size_t k = 0; k < scored.size() && bestScore < INFINITY; k++) {
+        Identifier e     = scored[k].second;
+        double     score = -scored[k].first;
+        if (min(w.downCount[e], w.upCount[e]) < PSEUDOCOST_RELIABILITY && idle < PSEUDOCOST_LOOKAHEAD && strong < STRONG_CANDIDATES) {
+            if (!saved) {
+                w.lp->getBasis(basis);
+                saved = true;
+            }//if
+            double down, up;
+            strongBounds(w, e, lpval, basis, down, up);
+            score = branchScore(down, up);
+            idle  = (score > bestScore) ? 0 : idle + 1;
+            strong++;
+        }//if
+        if (score > bestScore) {
+            bestScore = score;
+            re        = e;
+        }//if
+    }//for
+    return re;
+}
+
+// Records the bound gain of moving edge e by move towards 0 or 1
+void TravellingSalesperson::updatePseudocost(SearchWorker& w, Identifier e, bool up, double move, double gain) {
+    if (move < LP_EPSILON)
         return;
+    if (up) {
+        w.upGain[e] += gain / move;
+        w.upCount[e]++;
     }//if
+    else {
+        w.downGain[e] += gain / move;
+        w.downCount[e]++;
+    }//else
+}
+
+// Moves the LP of a worker to a node: releases the edges fixed and the
+// subtour rows pinned for the previous node, applies the node's ones
+// and, when the worker solved the parent, starts from the parent's
+// basis. A child solved right after its parent finds that basis in the
+// LP already.
+void TravellingSalesperson::applyNode(SearchWorker& w, const BranchNode& node) {
+    for (Identifier id : w.fixed) {
+        if (w.eliminated[id]) {
+            w.lp->setBounds(id, IGNORE_EDGE, IGNORE_EDGE);
+            w.constraints[id] = IGNORE_EDGE_CONSTRAINT;
+        }//if
+        else {
+            w.lp->setBounds(id, IGNORE_EDGE, SELECT_EDGE);
+            w.constraints[id] = NO_CONSTRAINT;
+        }//else
+    }//for
+    w.fixed.clear();
+    for (size_t id : w.pinned)
+        w.pool->release(id, *w.lp);
+    w.pinned.clear();
+    applyEliminated(w);
     
-    double lpval = lp.getObjValue();
+    for (size_t k = 0; k < node.fixes.size(); k++) {
+        Identifier id     = node.fixedEdge(k);
+        bool       select = node.isSelected(k);
+        w.lp->setBounds(id, select ? SELECT_EDGE : IGNORE_EDGE, select ? SELECT_EDGE : IGNORE_EDGE);
+        w.constraints[id] = select ? SELECT_EDGE_CONSTRAINT : IGNORE_EDGE_CONSTRAINT;
+        w.fixed.push_back(id);
+    }//for
+    for (size_t k = 0; k < node.sets.size(); ) {
+        Cut  set;
+        bool atLeastFour;
+        k = node.fixedSet(k, set.nodes, atLeastFour);
+        w.pinned.push_back(w.pool->pin(set, atLeastFour, *w.lp));
+    }//for
+    
+    if (node.owner == w.id && node.parentStamp != w.stamp && !node.basis.columns.empty()) {
+        LPBasis mapped;
+        w.pool->mapBasis(node.basis, node.basisCuts, mapped);
+        w.lp->setBasis(mapped);
+    }//if
+}
+
+// Sum of the distances of the LP values from integrality
+double TravellingSalesperson::fractionality(SearchWorker& w) {
+    double re = 0;
+    for (double x : w.vals)
+        re += min(x, 1 - x);
+    return max(re, 0.0);
+}
+
+// Solves one node against the incumbent value tval and appends its
+// children, the right one (edge ignored, or x(δ(S)) >= 4) first so that
+// the left one is the newer of the two. Returns the length of the
+// tour found at this node, by the LP or by rounding its solution, the
+// tour being left in w.vals, or INFINITY.
+double TravellingSalesperson::processNode(SearchWorker& w, const BranchNode& node, double tval, vector<BranchNode>& children) {
+    TRACE_SCOPE("node", node.depth);
+    
+    // The incumbent may have improved since the node was queued
+    if (node.bound > tval) {
+        w.prunedNodes++;
+        return INFINITY;
+    }//if
+    applyNode(w, node);
+    w.bbNodes++;
+    w.maxDepth = max(w.maxDepth, node.depth);
+    
+    // The 1-tree settles the node without the LP when its bound exceeds
+    // the incumbent or it is a tour
+    double treeTour = INFINITY;
+    if (_oneTree && oneTreeBound(w, tval, treeTour) > tval) {
+        w.treePrunes++;
+        w.prunedNodes++;
+        return INFINITY;
+    }//if
+    if (treeTour < INFINITY) {
+        w.treePrunes++;
+        return treeTour;
+    }//if
+    
+    LPStatus tmp = solveLP(w);
+    LPStatus lp  = connect(w, tmp);
+    if (lp != LP_OPTIMAL && lp != LP_INFEASIBLE) {
+        // A solve that gave up proves nothing about the node; it gets one
+        // more try from the slack basis, factored afresh
+        LPBasis slack;
+        slack.columns.assign(w.lp->columnsCount(), LP_AT_LOWER);
+        slack.rows.assign(w.lp->rowsCount(), LP_BASIC);
+        w.lp->setBasis(slack);
+        lp = connect(w, solveLP(w));
+    }//if
+    w.stamp++;
+    if (lp == LP_INFEASIBLE || node.depth > (long) _edges.size()) {
+        w.prunedNodes++;
+        return INFINITY;
+    }//if
+    if (lp != LP_OPTIMAL) {
+        // Still unsolved, the node keeps its bound open to the end
+        vector<BranchNode> unsolved(1, node);
+        openBounds(unsolved);
+        w.unsolvedNodes++;
+        return INFINITY;
+    }//if
+    
+    double lpval = w.lp->objValue();
+    double frac  = fractionality(w);
+    if (node.branchEdge != INVALID_ID)
+        updatePseudocost(w, node.branchEdge, node.isSelected(node.fixes.size() - 1), node.branchMove, max(lpval - node.bound, 0.0));
+    if (node.depth == 1) {
+        rootBound = lpval;
+        _rootFrac = frac;
+    }//if
     // Cut the branch
     if (lpval > tval) {
-        return;
+        w.prunedNodes++;
+        return INFINITY;
+    }//if
+    w.lp->reducedCosts(w.reduced);
+    if (node.depth == 1) {
+        {
+            lock_guard<mutex> guard(_incumbentLock);
+            _rootReduced = w.reduced;
+            eliminateEdges(tval);
+        }
+        applyEliminated(w);
     }//if
-    Identifier branchIt = edgeToBranch(lp, constraints);
+    // The optimal basis of this node is the warm start of both children;
+    // it is taken before the branching rule makes trial solves. The
+    // children's estimate projects the gap closed at the root onto the
+    // fractionality left at this node.
+    BranchNode child;
+    child.depth       = node.depth + 1;
+    child.bound       = lpval;
+    child.estimate    = lpval;
+    if (_rootFrac > LP_EPSILON)
+        child.estimate += (tval - rootBound) * frac / _rootFrac;
+    child.owner       = w.id;
+    child.parentStamp = w.stamp;
+    w.lp->getBasis(child.basis);
+    w.pool->activeCuts(child.basisCuts);
+    
+    Cut        set;
+    bool       onSet;
+    Identifier branchIt;
+    {
+        PhaseTimer timer(w.phases[BRANCHING_PHASE]);
+        TRACE_SCOPE("branching", lpval);
+        onSet    = _branchRule == SUBTOUR_BRANCHING && w.pool->branchingSet(w.vals, set);
+        branchIt = onSet ? INVALID_ID : edgeToBranch(w, lpval);
+    }
     // Reached the leaf
-    if (branchIt == INVALID_ID) {
-        if (isTour(lp)) {
-            lp.getValues(_bestSolVals, _X);
-            tval = lpval;
-        }//if
-        return;
+    if (!onSet && branchIt == INVALID_ID) {
+        return isTour(w) ? lpval : INFINITY;
     }//if
+    w.branchings++;
     
-    // Branch left child
-    auto a = (_X[branchIt] >= (SELECT_EDGE_LB));
-    _model.add(a);
-    constraints[branchIt] = SELECT_EDGE_CONSTRAINT;
-    branchAndBound(tval, depth, constraints);
-    _model.remove(a);
-    constraints[branchIt] = NO_CONSTRAINT;
+    child.fixes = node.fixes;
+    child.sets  = node.sets;
+    fixByReducedCost(w, lpval, tval, child);
+    if (onSet) {
+        child.branchEdge = INVALID_ID;
+        child.branchMove = 0;
+        
+        // Branch right child
+        child.fixSet(set.nodes, true);
+        children.push_back(child);
+        
+        // Branch left child
+        child.sets = node.sets;
+        child.fixSet(set.nodes, false);
+        children.push_back(child);
+        return roundingHeuristic(w, node.depth, tval);
+    }//if
     
     // Branch right child
-    auto b = (_X[branchIt] <= (LP_EPSILON));
-    _model.add(b);
-    constraints[branchIt] = IGNORE_EDGE_CONSTRAINT;
-    branchAndBound(tval, depth, constraints);
-    _model.remove(b);
-    constraints[branchIt] = NO_CONSTRAINT;
-}
-
-void TravellingSalesperson::addEdgeToConstraints(Edge& e, Identifier key, map<Identifier, IloExpr>& map) {
-    std::map<Identifier, IloExpr>::iterator it = map.find(key);
-    if (it == map.end()) {
-        IloExpr newConstraint(_env);
-        newConstraint += _X[e.identifier()];
-        map.insert(make_pair(key, newConstraint));
+    child.branchEdge = branchIt;
+    child.branchMove = w.vals[branchIt];
+    child.fix(branchIt, false);
+    children.push_back(child);
+    
+    // Branch left child
+    child.fixes.pop_back();
+    child.fix(branchIt, true);
+    child.branchMove = 1 - w.vals[branchIt];
+    children.push_back(child);
+    return roundingHeuristic(w, node.depth, tval);
+}
+
+// Rounds the LP solution of a node to a tour and improves it by local
+// search, at the root and at every ROUNDING_INTERVAL-th node of a worker.
+// Returns the length of the tour if it is shorter than tval, the tour
+// being left in w.vals, or INFINITY.
+double TravellingSalesperson::roundingHeuristic(SearchWorker& w, long depth, double tval) {
+    if (depth > 1 && w.bbNodes % ROUNDING_INTERVAL != 0)
+        return INFINITY;
+    PhaseTimer timer(w.phases[HEURISTIC_PHASE]);
+    TRACE_SCOPE("rounding", depth);
+    
+    vector<Identifier> tour;
+    _improver->roundLP(w.vals, tour);
+    double re = _improver->improve(tour);
+    if (re >= tval)
+        return INFINITY;
+    
+    _improver->edgeValues(tour, w.vals);
+    w.heuristicTours++;
+    return re;
+}
+
+// Held-Karp bound of the node's subproblem: a few ascent steps from the
+// root penalties under the edges fixed in the LP of the worker. The sets
+// of subtour branching are left out, which only weakens the bound. When
+// a 1-tree is a tour no longer than tval, its length goes to tour and
+// the tour to w.vals.
+double TravellingSalesperson::oneTreeBound(SearchWorker& w, double tval, double& tour) {
+    vector<double>     pi = _rootPenalties;
+    vector<Identifier> nodes;
+    double re = _treeBound->ascent(pi, w.constraints, tval, HK_NODE_ITERATIONS, nodes);
+    if (!nodes.empty() && _improver->length(nodes) <= tval) {
+        tour = _improver->length(nodes);
+        _improver->edgeValues(nodes, w.vals);
     }//if
-    else {
-        it->second += _X[e.identifier()];
-    }//else
+    return re;
+}
+
+// Penalties of the root 1-tree, raised towards the greedy tour; they
+// start the ascent at every node and rank the alpha-nearness candidates
+// of the local search
+void TravellingSalesperson::rootPenalties() {
+    vector<Identifier> tour;
+    _improver->roundLP(vector<double>(), tour);
+    double target = _improver->improve(tour);
+    
+    _rootPenalties.assign(_graph->nodesCount(), 0);
+    oneTreeRoot = _treeBound->ascent(_rootPenalties, vector<int>(_edges.size(), NO_CONSTRAINT), target, HK_ROOT_ITERATIONS, tour);
+    
+    vector<vector<Identifier> > candidates;
+    _treeBound->alphaNeighbors(_rootPenalties, LS_NEIGHBORS, candidates);
+    _improver->useCandidates(candidates);
+}
+
+// Solves the whole problem by the dynamic program of TourDP; the tour
+// is the first incumbent and its length the root bound
+double TravellingSalesperson::dynamicProgram() {
+    TourDP             dp(*_graph);
+    vector<Identifier> tour;
+    double re = dp.optimumTour(tour);
+    if (re < INFINITY)
+        dp.tourEdges(tour, _bestSolVals);
+    
+    _initialHeuristic = "dynamic programming";
+    initialTour = re;
+    rootBound   = re;
+    oneTreeRoot = 0;
+    return re;
 }
 
-void TravellingSalesperson::addEdgeComponentConstraints(Edge& e, DisjointSets& islands, map<Identifier, IloExpr>& map) {
-    Identifier rootId = islands.find(e.source());
-    std::map<Identifier, IloExpr>::iterator it = map.find(rootId);
-    if (it == map.end()) {
-        IloExpr newConstraint(_env);
-        newConstraint += _X[e.identifier()];
-        map.insert(make_pair(rootId, newConstraint));
+// Keeps the shorter of a new tour and the incumbent; the value is read
+// without locking everywhere else
+void TravellingSalesperson::updateIncumbent(double value, const vector<double>& vals) {
+    lock_guard<mutex> guard(_incumbentLock);
+    if (value <= _tval.load()) {
+        if (value < _tval.load() - LP_EPSILON)
+            recordIncumbent(value);
+        _tval.store(value);
+        _bestSolVals = vals;
+        eliminateEdges(value);
     }//if
-    else {
-        it->second += _X[e.identifier()];
-    }//else
+}
+
+// Fixes to 0 for the whole search every edge whose root reduced cost
+// lifts the root bound above tval; _incumbentLock must be held
+void TravellingSalesperson::eliminateEdges(double tval) {
+    if (_rootReduced.empty())
+        return;
+    for (size_t i = 0; i < _rootReduced.size(); i++) {
+        if (!_isEliminated[i] && rootBound + _rootReduced[i] > tval + LP_EPSILON) {
+            _isEliminated[i] = true;
+            _eliminated.push_back(i);
+        }//if
+    }//for
+    _eliminatedCount = _eliminated.size();
+}
+
+// Fixes in the LP of a worker the edges eliminated since it last looked
+void TravellingSalesperson::applyEliminated(SearchWorker& w) {
+    if (_eliminatedCount.load() == w.eliminatedSeen)
+        return;
+    
+    lock_guard<mutex> guard(_incumbentLock);
+    for (; w.eliminatedSeen < _eliminated.size(); w.eliminatedSeen++) {
+        Identifier id = _eliminated[w.eliminatedSeen];
+        w.eliminated[id]  = true;
+        w.constraints[id] = IGNORE_EDGE_CONSTRAINT;
+        w.lp->setBounds(id, IGNORE_EDGE, IGNORE_EDGE);
+    }//for
+}
+
+// Local reduced-cost fixing: an edge at a bound whose reduced cost would
+// lift the node's bound lpval above tval when moved keeps that bound in
+// the node's subtree. The fixes go to the children's.
+void TravellingSalesperson::fixByReducedCost(SearchWorker& w, double lpval, double tval, BranchNode& child) {
+    for (size_t i = 0; i < w.reduced.size(); i++) {
+        if (w.constraints[i] != NO_CONSTRAINT) continue;
+        if (w.vals[i] <= IGNORE_EDGE_UB && lpval + w.reduced[i] > tval + LP_EPSILON)
+            child.fix(i, false);
+        else if (w.vals[i] >= SELECT_EDGE_LB && lpval - w.reduced[i] > tval + LP_EPSILON)
+            child.fix(i, true);
+        else
+            continue;
+        w.localFixes++;
+    }//for
+}
+
+void TravellingSalesperson::queueNodes(SearchWorker& w, NodeQueue& queue, vector<BranchNode>& nodes) {
+    for (BranchNode& node : nodes)
+        queue.push(node);
+    w.maxOpen    = max(w.maxOpen, queue.size());
+    w.maxSpilled = max(w.maxSpilled, queue.spilledCount());
+}
+
+// The next node for a worker: the next one of its own queue, else one
+// stolen from another worker's queue
+bool TravellingSalesperson::nextNode(SearchWorker& w, BranchNode& node) {
+    {
+        lock_guard<mutex> guard(w.lock);
+        if (w.nodes->pop(node))
+            return true;
+    }
+    
+    for (size_t k = 1; k < _workers.size(); k++) {
+        SearchWorker& victim = *_workers[(w.id + k) % _workers.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (victim.nodes->steal(node))
+            return true;
+    }//for
+    return false;
+}
+
+void TravellingSalesperson::workerLoop(SearchWorker& w) {
+    BranchNode         node;
+    vector<BranchNode> children;
+    
+    // A node counts as open until its children are queued, so no worker
+    // quits while another one can still produce work
+    while (_openNodes.load() > 0 && !_stopped.load()) {
+        if (!nextNode(w, node)) {
+            limitReached();
+            this_thread::yield();
+            continue;
+        }//if
+        
+        children.clear();
+        double tour = processNode(w, node, _tval.load(), children);
+        if (tour < INFINITY)
+            updateIncumbent(tour, w.vals);
+        
+        if (!children.empty()) {
+            _openNodes += children.size();
+            openBounds(children);
+            lock_guard<mutex> guard(w.lock);
+            queueNodes(w, *w.nodes, children);
+        }//if
+        closeBound(node.bound);
+        _openNodes--;
+        _nodesDone++;
+        limitReached();
+    }//while
+}
+
+BranchNode TravellingSalesperson::rootNode() {
+    BranchNode root;
+    root.depth       = 1;
+    root.bound       = -INFINITY;
+    root.estimate    = -INFINITY;
+    root.branchEdge  = INVALID_ID;
+    root.branchMove  = 0;
+    root.owner       = NO_OWNER;
+    root.parentStamp = 0;
+    return root;
+}
+
+void TravellingSalesperson::parallelSearch() {
+    vector<BranchNode> root(1, rootNode());
+    openBounds(root);
+    _workers[0]->nodes->push(root[0]);
+    _openNodes = 1;
+    
+    vector<thread> threads;
+    for (size_t k = 1; k < _workers.size(); k++)
+        threads.push_back(thread(&TravellingSalesperson::workerLoop, this, ref(*_workers[k])));
+    workerLoop(*_workers[0]);
+    for (thread& t : threads)
+        t.join();
+}
+
+// Reproducible search: the open nodes form one queue, processed in
+// batches. Node k of a batch always goes to worker k mod workers, every
+// worker sees the incumbent of the batch start, and tours and children
+// are merged in batch order, so thread timing cannot change the result.
+void TravellingSalesperson::deterministicSearch() {
+    NodeQueue          open(_selection, _nodeMemory);
+    vector<BranchNode> root(1, rootNode());
+    openBounds(root);
+    open.push(root[0]);
+    _openNodes = 1;
+    
+    size_t workers = _workers.size();
+    while (!open.empty() && !limitReached()) {
+        size_t batchSize = min(open.size(), workers * NODES_PER_BATCH);
+        vector<BranchNode>         batch(batchSize);
+        vector<vector<BranchNode> > children(batchSize);
+        vector<double>             tours(batchSize, INFINITY);
+        vector<vector<double> >    tourVals(batchSize);
+        for (BranchNode& node : batch)
+            open.pop(node);
+        
+        double tval = _tval.load();
+        auto work = [&](size_t k) {
+            SearchWorker& w = *_workers[k];
+            for (size_t j = k; j < batchSize; j += workers) {
+                tours[j] = processNode(w, batch[j], tval, children[j]);
+                if (tours[j] < INFINITY)
+                    tourVals[j] = w.vals;
+            }//for
+        };
+        vector<thread> threads;
+        for (size_t k = 1; k < workers && k < batchSize; k++)
+            threads.push_back(thread(work, k));
+        work(0);
+        for (thread& t : threads)
+            t.join();
+        
+        for (size_t j = 0; j < batchSize; j++)
+            if (tours[j] < INFINITY && tours[j] <= _tval.load())
+                updateIncumbent(tours[j], tourVals[j]);
+        // The children of the first node of the batch are queued last,
+        // so that they win the ties
+        for (size_t j = batchSize; j > 0; j--) {
+            openBounds(children[j - 1]);
+            queueNodes(*_workers[0], open, children[j - 1]);
+            closeBound(batch[j - 1].bound);
+        }//for
+        _nodesDone += batchSize;
+        _openNodes  = open.size();
+    }//while
+}
+
+// Adds a new best tour to the history of the statistics
+void TravellingSalesperson::recordIncumbent(double value) {
+    if (value == INFINITY)
+        return;
+    TRACE_INSTANT("incumbent", value);
+    IncumbentUpdate update;
+    update.time   = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    update.length = value;
+    update.nodes  = _nodesDone.load();
+    _stats.incumbents.push_back(update);
+}
+
+// Records the bounds of nodes about to be queued; they stay recorded
+// until the nodes are solved, so the smallest one bounds every tour not
+// found yet
+void TravellingSalesperson::openBounds(const vector<BranchNode>& nodes) {
+    lock_guard<mutex> guard(_boundsLock);
+    for (const BranchNode& node : nodes)
+        _openBounds.insert(node.bound);
+}
+
+// Forgets the bound of a solved node, after its children's were recorded
+void TravellingSalesperson::closeBound(double bound) {
+    lock_guard<mutex> guard(_boundsLock);
+    _openBounds.erase(_openBounds.find(bound));
+}
+
+// Best lower bound on the length of any tour: the smallest bound of an
+// open node, or the root 1-tree bound if larger, and never more than
+// the incumbent
+double TravellingSalesperson::globalBound() {
+    double re = _tval.load();
+    lock_guard<mutex> guard(_boundsLock);
+    if (!_openBounds.empty())
+        re = min(re, max(*_openBounds.begin(), oneTreeRoot));
+    return re;
+}
+
+// Checks the time, node and gap limits and stops the search at the
+// first one reached; the limits are checked between nodes, so a node
+// being solved is finished first. A tree without open nodes is done,
+// and no limit stops it.
+bool TravellingSalesperson::limitReached() {
+    if (_stopped.load())
+        return true;
+    if (_openNodes.load() == 0)
+        return false;
+    
+    SolveStatus reached = SOLVED_OPTIMAL;
+    double      elapsed = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    if (_timeLimit > 0 && elapsed >= _timeLimit)
+        reached = TIME_LIMIT;
+    else if (_nodeLimit > 0 && _nodesDone.load() >= _nodeLimit)
+        reached = NODE_LIMIT;
+    else if (_absoluteGap > 0 || _relativeGap > 0) {
+        double tval = _tval.load();
+        double gap  = tval - globalBound();
+        if (gap <= _absoluteGap || gap <= _relativeGap * fabs(tval))
+            reached = GAP_LIMIT;
+    }//else if
+    if (reached == SOLVED_OPTIMAL)
+        return false;
+    
+    lock_guard<mutex> guard(_incumbentLock);
+    if (!_stopped.load()) {
+        _status = reached;
+        _stopped.store(true);
+    }//if
+    return true;
+}
+
+void TravellingSalesperson::branchAndBound() {
+    if (_deterministic)
+        deterministicSearch();
+    else
+        parallelSearch();
 }
 
 vector<Edge> TravellingSalesperson::solutionEdgeSet() {
     vector<Edge> re;
-    for (size_t i = 0; i < _edges.size(); i++)
+    for (size_t i = 0; i < _bestSolVals.size(); i++)
         if (_bestSolVals[i] >= SELECT_EDGE_LB)
             re.push_back(_edges[i]);
     
@@ -284,36 +1073,343 @@ vector<Edge> TravellingSalesperson::solutionEdgeSet() {
 }
 
 vector<Edge> TravellingSalesperson::optimumTour(Graph& graph) {
-    clock_t time = clock();
+    chrono::steady_clock::time_point time = chrono::steady_clock::now();
+    double                           cpu  = Utility::zeit();
+    _stats     = SolveStatistics();
+    _start     = time;
+    _status    = SOLVED_OPTIMAL;
+    _stopped   = false;
+    _nodesDone = 0;
+    _openBounds.clear();
     _graph = &graph;
-    _edges = _graph->edges();
     
-    // Initialize the model
-    initLPModel();
-
-    // Branch and bound
-    double tval = upperBound();
-    vector<int> constraints(_edges.size(), NO_CONSTRAINT);
-    branchAndBound(tval, 0, constraints);
+    {
+        PhaseTimer timer(_stats.phases[LOAD_PHASE], false);
+        
+        // The LP needs one variable per edge, so an implicit graph without a
+        // candidate edge set has to be expanded here; implicit weights only
+        // save memory together with candidates
+        if (_graph->isImplicit() && _graph->edgesCount() == 0)
+            _graph->materializeEdges();
+        _edges = _graph->edges();
+        
+        // The workers share the adjacency structures read-only, so they are
+        // built before any thread starts
+        _adjacency = &_graph->sortedAdjacency();
+        _graph->adjacency();
+    }
+    
+    for (SearchWorker* w : _workers)
+        deleteWorker(w);
+    _workers.clear();
+    _bestSolVals.clear();
+    rootBound = 0;
+    _rootFrac = 0;
+    _eliminated.clear();
+    _isEliminated.assign(_edges.size(), false);
+    _eliminatedCount = 0;
+    _rootReduced.clear();
+    
+    // Small graphs are solved by dynamic programming, without the LP
+    size_t ncount = _graph->nodesCount();
+    if (ncount >= 3 && ncount <= _dpNodes && TourDP::tableBytes(ncount) <= DP_MEMORY_LIMIT) {
+        {
+            PhaseTimer timer(_stats.phases[DP_PHASE], false);
+            _tval = dynamicProgram();
+        }
+        lowerBound = _tval;
+        recordIncumbent(_tval);
+    }//if
+    else {
+        // Initialize the models, one per worker
+        {
+            PhaseTimer timer(_stats.phases[MODEL_PHASE], false);
+            for (size_t k = 0; k < max(_threads, (size_t) 1); k++)
+                _workers.push_back(createWorker((int) k));
+            delete _improver;
+            _improver = new TourImprover(*_graph, _localSearch);
+            delete _treeBound;
+            _treeBound = new OneTreeBound(*_graph);
+        }
+        {
+            PhaseTimer timer(_stats.phases[HEURISTIC_PHASE], false);
+            TRACE_SCOPE("heuristic", 0);
+            rootPenalties();
+            _tval       = upperBound();
+        }
+        initialTour = _tval;
+        recordIncumbent(_tval);
+        
+        // Branch and bound
+        branchAndBound();
+        lowerBound  = globalBound();
+        
+        // A limit can still fire while the last nodes are being solved;
+        // once they all closed their bounds, the search was complete
+        if (_stopped.load() && _openBounds.empty())
+            _status = SOLVED_OPTIMAL;
+    }//else
+    
+    // A search that was not stopped decided the problem over the edges
+    // of the graph, which may be only candidates, unless nodes the LP
+    // could not solve left their bounds below the best tour
+    if (_status == SOLVED_OPTIMAL && lowerBound < _tval.load())
+        _status = UNSOLVED_NODES;
+    else if (_status == SOLVED_OPTIMAL && _tval.load() == INFINITY)
+        _status = NO_TOUR;
+    else if (_status == SOLVED_OPTIMAL && _graph->hasCandidates())
+        _status = CANDIDATES_OPTIMAL;
     
     // Extract the set of edges
     vector<Edge> re = solutionEdgeSet();
 
-    _env.end();
-    runTime = clock() - time;
+    lpSolves     = 0;
+    lpIterations = 0;
+    bbNodes      = 0;
+    maxRows      = 0;
+    maxOpen      = 0;
+    maxSpilled   = 0;
+    poolSize     = 0;
+    branchings       = 0;
+    localFixes       = 0;
+    heuristicTours   = 0;
+    treePrunes       = 0;
+    unsolvedNodes    = 0;
+    strongSolves     = 0;
+    strongIterations = 0;
+    for (SearchWorker* w : _workers) {
+        lpSolves     += w->lpSolves;
+        lpIterations += w->lpIterations;
+        bbNodes      += w->bbNodes;
+        maxRows       = max(maxRows, w->maxRows);
+        maxOpen      += w->maxOpen;
+        maxSpilled   += w->maxSpilled;
+        branchings       += w->branchings;
+        localFixes       += w->localFixes;
+        heuristicTours   += w->heuristicTours;
+        treePrunes       += w->treePrunes;
+        unsolvedNodes    += w->unsolvedNodes;
+        strongSolves     += w->strongSolves;
+        strongIterations += w->strongIterations;
+        poolSize     += w->pool->size();
+        for (int p = 0; p < PHASE_COUNT; p++)
+            _stats.phases[p] += w->phases[p];
+        for (int t = 0; t < CUT_TYPES; t++)
+            _stats.cuts[t] += w->cuts[t];
+        _stats.nodesPruned += w->prunedNodes;
+        _stats.maxDepth     = max(_stats.maxDepth, w->maxDepth);
+        deleteWorker(w);
+    }//for
+    _workers.clear();
+    runTime = chrono::duration<double>(chrono::steady_clock::now() - time).count();
+    
+    _stats.total.wall     = runTime;
+    _stats.total.cpu      = Utility::zeit() - cpu;
+    _stats.lpSolves       = lpSolves;
+    _stats.lpIterations   = lpIterations;
+    _stats.nodesExplored  = bbNodes;
+    _stats.nodesOpen      = _openBounds.size();
+    _stats.tourLength     = _tval.load();
+    _stats.lowerBound     = lowerBound;
+    _stats.gap            = optimalityGap();
     return re;
 }
 
 double TravellingSalesperson::runningTime(){
-    return runTime / CLOCKS_PER_SEC;
+    return runTime;
 }
 
-void TravellingSalesperson::_printSol(IloCplex sol){
-    IloNumArray tmpvals (_env);
-    sol.getValues(tmpvals, _X);
-    
-    for (size_t i = 0; i < _graph->edgesCount(); i++) {
-        if (tmpvals[i] >= LP_EPSILON)
-            cout << _edges[i].source() << "-" << _edges[i].destination() << ":" << tmpvals[i] << endl;
+long TravellingSalesperson::lpSolvesCount() {
+    return lpSolves;
+}
+
+long TravellingSalesperson::lpIterationsCount() {
+    return lpIterations;
+}
+
+long TravellingSalesperson::branchNodesCount() {
+    return bbNodes;
+}
+
+double TravellingSalesperson::rootLowerBound() {
+    return rootBound;
+}
+
+size_t TravellingSalesperson::cutPoolSize() {
+    return poolSize;
+}
+
+size_t TravellingSalesperson::maxLPRows() {
+    return maxRows;
+}
+
+// Peak number of open nodes, summed over the workers' queues
+size_t TravellingSalesperson::maxOpenNodes() {
+    return maxOpen;
+}
+
+size_t TravellingSalesperson::maxSpilledNodes() {
+    return maxSpilled;
+}
+
+long TravellingSalesperson::branchingsCount() {
+    return branchings;
+}
+
+// Edges fixed to 0 for the whole search so far; may be read while the
+// search runs
+size_t TravellingSalesperson::eliminatedEdgesCount() {
+    return _eliminatedCount.load();
+}
+
+// Edges fixed by reduced costs at nodes, for their subtrees only
+long TravellingSalesperson::localFixesCount() {
+    return localFixes;
+}
+
+// Length of the first incumbent, the best construction heuristic after
+// local search
+double TravellingSalesperson::initialTourLength() {
+    return initialTour;
+}
+
+// Name of the construction heuristic that gave the first incumbent
+string TravellingSalesperson::initialHeuristic() {
+    return _initialHeuristic;
+}
+
+// Tours rounded from LP solutions that were shorter than the incumbent
+// when found
+long TravellingSalesperson::heuristicToursCount() {
+    return heuristicTours;
+}
+
+// Held-Karp bound of the root after the ascent
+double TravellingSalesperson::oneTreeRootBound() {
+    return oneTreeRoot;
+}
+
+// Nodes closed by their 1-tree before the LP was solved
+long TravellingSalesperson::treePrunesCount() {
+    return treePrunes;
+}
+
+long TravellingSalesperson::unsolvedNodesCount() {
+    return unsolvedNodes;
+}
+
+// LP solves and simplex iterations spent on strong branching; they are
+// not part of lpSolvesCount() and lpIterationsCount()
+long TravellingSalesperson::strongSolvesCount() {
+    return strongSolves;
+}
+
+long TravellingSalesperson::strongIterationsCount() {
+    return strongIterations;
+}
+
+// Time spent choosing branches, summed over the workers
+double TravellingSalesperson::branchingTime() {
+    return _stats.phases[BRANCHING_PHASE].wall;
+}
+
+// Statistics of the last call to optimumTour
+const SolveStatistics& TravellingSalesperson::statistics() {
+    return _stats;
+}
+
+SolveStatus TravellingSalesperson::status() {
+    return _status;
+}
+
+// Lower bound proven on the optimum: the tour length when the search
+// finished, else the smallest bound of the nodes left open
+double TravellingSalesperson::finalLowerBound() {
+    return lowerBound;
+}
+
+// Gap between the tour found and the lower bound, relative to the tour
+double TravellingSalesperson::optimalityGap() {
+    double tval = _tval.load();
+    if (tval == INFINITY)
+        return (_status == NO_TOUR) ? 0 : INFINITY;
+    if (tval == lowerBound)
+        return 0;
+    return (tval - lowerBound) / fabs(tval);
+}
+
+void TravellingSalesperson::setCombCuts(bool combCuts) {
+    _combCuts = combCuts;
+}
+
+// Number of search threads, each with its own LP
+void TravellingSalesperson::setThreads(size_t threads) {
+    _threads = threads;
+}
+
+void TravellingSalesperson::setDeterministic(bool deterministic) {
+    _deterministic = deterministic;
+}
+
+void TravellingSalesperson::setBranchRule(BranchRule rule) {
+    _branchRule = rule;
+}
+
+// Moves used to improve the constructed tours and the tours rounded from
+// LP solutions
+void TravellingSalesperson::setLocalSearch(LocalSearch localSearch) {
+    _localSearch = localSearch;
+}
+
+// Graphs of at most that many nodes are solved by dynamic programming
+// instead of branch and bound, memory permitting; 0 turns it off
+void TravellingSalesperson::setDPNodes(size_t nodes) {
+    _dpNodes = nodes;
+}
+
+// Stops the search after that many seconds of wall time since the call
+// to optimumTour, leaving the best tour found; 0 means no limit
+void TravellingSalesperson::setTimeLimit(double seconds) {
+    _timeLimit = seconds;
+}
+
+// Stops the search after that many branch and bound nodes; 0 means no
+// limit
+void TravellingSalesperson::setNodeLimit(long nodes) {
+    _nodeLimit = nodes;
+}
+
+// Stops the search once the incumbent is within that fraction of itself
+// from the global lower bound
+void TravellingSalesperson::setRelativeGap(double gap) {
+    _relativeGap = gap;
+}
+
+// Stops the search once the incumbent is within that much of the global
+// lower bound
+void TravellingSalesperson::setAbsoluteGap(double gap) {
+    _absoluteGap = gap;
+}
+
+// Bounds every node by its 1-tree before its LP; the cut LP is at least
+// as strong, so this pays off when LP solves are dear
+void TravellingSalesperson::setOneTreeBound(bool oneTree) {
+    _oneTree = oneTree;
+}
+
+void TravellingSalesperson::setNodeSelection(NodeSelection selection) {
+    _selection = selection;
+}
+
+// Memory in bytes for the open nodes of all workers together, zero for
+// no limit; the nodes beyond it go to temporary files
+void TravellingSalesperson::setNodeMemory(size_t bytes) {
+    _nodeMemory = bytes;
+}
+
+void TravellingSalesperson::_printSol(SearchWorker& w){
+    for (size_t i = 0; i < w.vals.size(); i++) {
+        if (w.vals[i] >= LP_EPSILON)
+            cout << _edges[i].source() << "-" << _edges[i].destination() << ":" << w.vals[i] << endl;
     }//for
 }
@@ -12,7 +12,19 @@
 #include <vector>
 #include <math.h>
 #include <map>
-#include <ilcplex/ilocplex.h>
+#include <set>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include "lp.h"
+#include "separation.h"
+#include "cutpool.h"
+#include "nodequeue.h"
+#include "localsearch.h"
+#include "construction.h"
+#include "onetree.h"
+#include "tourdp.h"
+#include "stats.h"
 #ifndef __LP__datastructs__
 #include "datastructs.h"
 #endif
@@ -24,39 +36,220 @@ using namespace std;
 #define NOT_VALID_TOUR_LEN  -10
 #define DEFAULT_START_NODE  0
 
+enum BranchRule {FIRST_FRACTIONAL, MOST_FRACTIONAL, STRONG_BRANCHING, PSEUDOCOST_BRANCHING, SUBTOUR_BRANCHING};
+
+// How the search ended: with a proven optimum, with a tour optimal among
+// the candidate edges of the graph only, with the proof that the edges
+// hold no tour, with nodes whose LP could not be solved and whose bounds
+// stay below the best tour, or at the first limit reached, the best tour
+// found so far being returned
+enum SolveStatus {SOLVED_OPTIMAL, CANDIDATES_OPTIMAL, NO_TOUR, UNSOLVED_NODES, TIME_LIMIT, NODE_LIMIT, GAP_LIMIT};
+
+// Everything one search thread owns: its LP with the cuts it has found,
+// the separators' scratch space, and its queue of open nodes. The owner
+// pops from its queue in the order of the selection rule, idle workers
+// steal from it.
+struct SearchWorker {
+    int                   id;
+    LPSolver*             lp;
+    SubtourSeparator*     separator;
+    CombSeparator*        combSeparator;
+    CutPool*              pool;
+    vector<double>        vals;
+    vector<int>           constraints;
+    vector<Identifier>    fixed;
+    vector<size_t>        pinned;
+    vector<char>          eliminated;
+    size_t                eliminatedSeen;
+    vector<double>        reduced;
+    long                  stamp;
+    
+    // Pseudocosts: summed bound gain per unit of change in each direction
+    vector<double>        downGain;
+    vector<double>        upGain;
+    vector<int>           downCount;
+    vector<int>           upCount;
+    
+    mutex                 lock;
+    NodeQueue*            nodes;
+    
+    long                  lpSolves;
+    long                  lpIterations;
+    long                  bbNodes;
+    size_t                maxRows;
+    size_t                maxOpen;
+    size_t                maxSpilled;
+    long                  branchings;
+    long                  localFixes;
+    long                  heuristicTours;
+    long                  treePrunes;
+    long                  strongSolves;
+    long                  strongIterations;
+    PhaseTime             phases[PHASE_COUNT];
+    long                  cuts[CUT_TYPES];
+    long                  prunedNodes;
+    long                  unsolvedNodes;
+    long                  maxDepth;
+};
+
 class TravellingSalesperson {
 private:
     Graph*                _graph;
-    vector<Edge>          _edges;
-    vector<vector<Edge> > _adjancyMatrix;
-    IloEnv                _env;
-    IloModel              _model;
-    IloNumVarArray        _X;
-    IloNumArray           _bestSolVals;
+    ArrayView<Edge>       _edges;
+    const Adjacency*      _adjacency;
+    LPBackend             _backend;
+    bool                  _combCuts;
+    size_t                _threads;
+    bool                  _deterministic;
+    BranchRule            _branchRule;
+    NodeSelection         _selection;
+    size_t                _nodeMemory;
+    LocalSearch           _localSearch;
+    size_t                _dpNodes;
+    TourImprover*         _improver;
+    string                _initialHeuristic;
+    bool                  _oneTree;
+    OneTreeBound*         _treeBound;
+    vector<double>        _rootPenalties;
+    double                _rootFrac;
+    vector<SearchWorker*> _workers;
+    atomic<double>        _tval;
+    atomic<long>          _openNodes;
+    mutex                 _incumbentLock;
+    vector<double>        _bestSolVals;
+    
+    // Limits of an anytime search; 0 means none
+    double                _timeLimit;
+    long                  _nodeLimit;
+    double                _relativeGap;
+    double                _absoluteGap;
+    chrono::steady_clock::time_point _start;
+    atomic<bool>          _stopped;
+    atomic<long>          _nodesDone;
+    SolveStatus           _status;
+    
+    // Bounds of the queued and running nodes; guarded by _boundsLock
+    multiset<double>      _openBounds;
+    mutex                 _boundsLock;
+    
+    SolveStatistics       _stats;
+    
+    // Edges fixed to 0 for the whole search, with the root LP that proves
+    // it; guarded by _incumbentLock
+    vector<Identifier>    _eliminated;
+    vector<char>          _isEliminated;
+    atomic<size_t>        _eliminatedCount;
+    vector<double>        _rootReduced;
     
-    void _printSol(IloCplex);
+    void _printSol(SearchWorker&);
     
 protected:
     double runTime;
+    long   lpSolves;
+    long   lpIterations;
+    long   bbNodes;
+    double rootBound;
+    size_t poolSize;
+    size_t maxRows;
+    size_t maxOpen;
+    size_t maxSpilled;
+    long   branchings;
+    long   localFixes;
+    long   heuristicTours;
+    double initialTour;
+    double oneTreeRoot;
+    double lowerBound;
+    long   treePrunes;
+    long   unsolvedNodes;
+    long   strongSolves;
+    long   strongIterations;
 
-    void         initLPModel                ();
-    IloCplex     solveLP                    ();
-    IloCplex     connect                    (IloCplex);
-    double       nna                        (Identifier = DEFAULT_START_NODE);
-    double       upperBound                 ();
-    bool         isTour                     (IloCplex);
-    void         branchAndBound             (double&, long, vector<int>&);
-    Identifier   edgeToBranch               (IloCplex&, vector<int>&);
-    vector<Edge> solutionEdgeSet            ();
-    void         addEdgeToConstraints       (Edge&, Identifier, map<Identifier, IloExpr>&);
-    void         addEdgeComponentConstraints(Edge&, DisjointSets&, map<Identifier, IloExpr>&);
+    SearchWorker* createWorker              (int);
+    void          deleteWorker              (SearchWorker*);
+    void          initLPModel               (SearchWorker&);
+    LPStatus      solveLP                   (SearchWorker&);
+    LPStatus      connect                   (SearchWorker&, LPStatus);
+    bool          addPoolCuts               (SearchWorker&);
+    bool          addSubtourCuts            (SearchWorker&);
+    bool          addCombCuts               (SearchWorker&);
+    bool          addCuts                   (SearchWorker&, const vector<Cut>&);
+    double        nna                       (vector<Identifier>&, Identifier = DEFAULT_START_NODE);
+    double        upperBound                ();
+    bool          isTour                    (SearchWorker&);
+    void          branchAndBound            ();
+    BranchNode    rootNode                  ();
+    void          parallelSearch            ();
+    void          deterministicSearch       ();
+    void          workerLoop                (SearchWorker&);
+    bool          nextNode                  (SearchWorker&, BranchNode&);
+    void          applyNode                 (SearchWorker&, const BranchNode&);
+    double        processNode               (SearchWorker&, const BranchNode&, double, vector<BranchNode>&);
+    double        fractionality             (SearchWorker&);
+    double        roundingHeuristic         (SearchWorker&, long, double);
+    double        oneTreeBound              (SearchWorker&, double, double&);
+    void          rootPenalties             ();
+    double        dynamicProgram            ();
+    void          queueNodes                (SearchWorker&, NodeQueue&, vector<BranchNode>&);
+    void          updateIncumbent           (double, const vector<double>&);
+    void          recordIncumbent           (double);
+    void          openBounds                (const vector<BranchNode>&);
+    void          closeBound                (double);
+    double        globalBound               ();
+    bool          limitReached              ();
+    void          eliminateEdges            (double);
+    void          applyEliminated           (SearchWorker&);
+    void          fixByReducedCost          (SearchWorker&, double, double, BranchNode&);
+    Identifier    edgeToBranch              (SearchWorker&, double);
+    Identifier    mostFractional            (SearchWorker&);
+    Identifier    strongBranch              (SearchWorker&, double, vector<Identifier>&, size_t);
+    Identifier    pseudocostBranch          (SearchWorker&, double);
+    void          strongBounds              (SearchWorker&, Identifier, double, const LPBasis&, double&, double&);
+    void          updatePseudocost          (SearchWorker&, Identifier, bool, double, double);
+    vector<Edge>  solutionEdgeSet           ();
     
 public:
-    TravellingSalesperson();
+    TravellingSalesperson(LPBackend = SIMPLEX_BACKEND);
     ~TravellingSalesperson();
     
     vector<Edge> optimumTour(Graph&);
     double       runningTime();
+    long         lpSolvesCount();
+    long         lpIterationsCount();
+    long         branchNodesCount ();
+    double       rootLowerBound   ();
+    size_t       cutPoolSize      ();
+    size_t       maxLPRows        ();
+    size_t       maxOpenNodes     ();
+    size_t       maxSpilledNodes  ();
+    void         setCombCuts      (bool);
+    void         setThreads       (size_t);
+    void         setDeterministic (bool);
+    void         setNodeSelection (NodeSelection);
+    void         setNodeMemory    (size_t);
+    void         setBranchRule    (BranchRule);
+    void         setLocalSearch   (LocalSearch);
+    void         setOneTreeBound  (bool);
+    void         setDPNodes       (size_t);
+    void         setTimeLimit     (double);
+    void         setNodeLimit     (long);
+    void         setRelativeGap   (double);
+    void         setAbsoluteGap   (double);
+    long         branchingsCount  ();
+    size_t       eliminatedEdgesCount();
+    long         localFixesCount  ();
+    double       initialTourLength();
+    string       initialHeuristic ();
+    long         heuristicToursCount();
+    double       oneTreeRootBound ();
+    long         treePrunesCount  ();
+    long         unsolvedNodesCount();
+    long         strongSolvesCount();
+    long         strongIterationsCount();
+    double       branchingTime    ();
+    SolveStatus  status           ();
+    double       finalLowerBound  ();
+    double       optimalityGap    ();
+    const SolveStatistics& statistics();
 };
 
 #endif /* defined(__TSP__tsp__) */
@@ -0,0 +1,69 @@
+//
+//  tspconvert.cpp
+//  TSP
+//
+//  Converts a graph from the text formats accepted by Graph::readGraphFile
+//  or from TSPLIB to the binary format, which Graph::readGraphFile maps in
+//  place.
+//
+
+#include <iostream>
+#include <string>
+#include <getopt.h>
+#include "datastructs.h"
+using namespace std;
+
+#define POSSIBLE_OPTIONS      "gt"
+#define GEOMETRIC_DATA_OPTION 'g'
+#define TSPLIB_DATA_OPTION    't'
+
+void usage(string p) {
+    cerr << "Usage: " << p << " [-g | -t] text_file binary_file\n";
+    cerr << "   -g    text_file has x-y coordinates\n";
+    cerr << "   -t    text_file is in TSPLIB format\n";
+}
+
+int main(int argc, char * argv[]) {
+    bool geometricData = false;
+    bool tsplibData    = false;
+    
+    int ch;
+    while ((ch = getopt(argc, argv, POSSIBLE_OPTIONS)) != EOF) {
+        switch (ch) {
+            case GEOMETRIC_DATA_OPTION:
+                geometricData = true;
+                break;
+            case TSPLIB_DATA_OPTION:
+                tsplibData = true;
+                break;
+            default:
+                usage(string(argv[0]));
+                return 1;
+        }//switch
+    }//while
+    
+    if (argc - optind != 2) {
+        usage(string(argv[0]));
+        return 1;
+    }//if
+    
+    try {
+        // Keep geo graphs implicit; only their coordinates are written
+        Graph g(geometricData, geometricData);
+        if (tsplibData)
+            g.readTSPLIBFile(argv[optind]);
+        else
+            g.readGraphFile(argv[optind]);
+        g.writeBinaryGraphFile(argv[optind + 1]);
+        cout << "Wrote " << g.nodesCount() << " nodes";
+        if (!g.isImplicit())
+            cout << " and " << g.edgesCount() << " edges";
+        cout << " to " << argv[optind + 1] << endl;
+    }//try
+    catch (const char* msg) {
+        cerr << msg << endl;
+        return 1;
+    }//catch
+    
+    return 0;
+}
@@ -9,6 +9,8 @@
 #include "util.h"
 #include <string>
 #include <iostream>
+#include <sys/resource.h>
+#include <time.h>
 using namespace std;
 
 #define SWAP(x, y, temp) {temp = x; x = y; y = temp;}
@@ -28,6 +30,14 @@ double Utility::realZeit() {
     return (double) time (0);
 }
 
+// CPU time of the calling thread alone
+double Utility::threadZeit() {
+    struct timespec ts;
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+    
+    return ((double) ts.tv_sec) + ((double) ts.tv_nsec)/1000000000.0;
+}
+
 /* function for creating a random set of points in unit square */
 bool Utility::buildXY (int ncount, int gridsize, vector<double>& xlist, vector<double>& ylist) {
     bool rval = true;
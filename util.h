@@ -15,11 +15,12 @@
 #include <map>
 using namespace std;
 
-static class Utility {
+class Utility {
 public:
     static bool   OUTPUT;
     static double zeit     ();
     static double realZeit ();
+    static double threadZeit();
     static bool   buildXY  (int, int, vector<double>&, vector<double>&);
 };
 